@@ -17,6 +17,7 @@ namespace cppfs
 
 class AbstractFileSystem;
 class AbstractFileIteratorBackend;
+class CopyOptions;
 
 
 /**
@@ -25,6 +26,19 @@ class AbstractFileIteratorBackend;
 */
 class CPPFS_API AbstractFileHandleBackend
 {
+public:
+    /**
+    *  @brief
+    *    Result of copying a directory tree in one operation
+    */
+    enum CopyResult
+    {
+        CopyNotSupported = 0, ///< The backend cannot copy the tree, nothing has been written
+        CopySucceeded,        ///< All entries have been copied
+        CopyFailed            ///< The copy has been started, but an entry could not be copied
+    };
+
+
 public:
     /**
     *  @brief
@@ -224,17 +238,91 @@ public:
     */
     virtual bool removeDirectory() = 0;
 
+    /**
+    *  @brief
+    *    Copy directory recursively
+    *
+    *  @param[in] dest
+    *    Destination directory (must be of the same type as this file handle)
+    *  @param[in] options
+    *    Copy options
+    *
+    *  @return
+    *    Result of the copy
+    *
+    *  @remarks
+    *    Backends can override this function to copy a directory tree in
+    *    one operation. The generic implementation is used only if it
+    *    returns CopyNotSupported, as the destination may contain partial
+    *    results (e.g., re-created links) otherwise. The default
+    *    implementation returns CopyNotSupported.
+    */
+    virtual CopyResult copyDirectoryRec(AbstractFileHandleBackend & dest, const CopyOptions & options);
+
+    /**
+    *  @brief
+    *    Clone directory recursively
+    *
+    *  @param[in] dest
+    *    Destination directory (must be of the same type as this file handle)
+    *  @param[in] options
+    *    Copy options
+    *  @param[out] clonedBytes
+    *    Receives the number of bytes that have been cloned
+    *  @param[out] copiedBytes
+    *    Receives the number of bytes that had to be copied
+    *
+    *  @return
+    *    'true' if successful, 'false' if cloning is not supported by the backend or an entry could not be copied
+    *
+    *  @remarks
+    *    Creates the directory structure and lets the copies share the
+    *    data of the original files where the file system supports it
+    *    (copy-on-write). Other files are copied. The default
+    *    implementation returns 'false'.
+    */
+    virtual bool cloneDirectory(AbstractFileHandleBackend & dest, const CopyOptions & options, unsigned long long & clonedBytes, unsigned long long & copiedBytes);
+
+    /**
+    *  @brief
+    *    Remove directory recursively without following symbolic links
+    *
+    *  @return
+    *    'true' if successful, 'false' if the generic implementation is to be used
+    *
+    *  @remarks
+    *    Backends can override this function to remove a directory tree in
+    *    one operation. The default implementation returns 'false'.
+    */
+    virtual bool removeDirectoryRec();
+
+    /**
+    *  @brief
+    *    Remove directory recursively in the background without following symbolic links
+    *
+    *  @return
+    *    'true' if the directory has been moved out of the way, 'false' if it is to be removed synchronously
+    *
+    *  @remarks
+    *    Backends can override this function to move the directory to a
+    *    trash location and remove it later. The default implementation
+    *    returns 'false'.
+    */
+    virtual bool removeDirectoryRecAsync();
+
     /**
     *  @brief
     *    Copy file
     *
     *  @param[in] dest
     *    Destination file or directory (must be of the same type as this file handle)
+    *  @param[in] options
+    *    Copy options (backends may ignore options they do not support)
     *
     *  @return
     *    'true' if successful, else 'false'
     */
-    virtual bool copy(AbstractFileHandleBackend & dest) = 0;
+    virtual bool copy(AbstractFileHandleBackend & dest, const CopyOptions & options) = 0;
 
     /**
     *  @brief
@@ -245,6 +333,11 @@ public:
     *
     *  @return
     *    'true' if successful, else 'false'
+    *
+    *  @remarks
+    *    If the destination is on another device, the backend has to
+    *    return 'false' with errno set to EXDEV. The file or directory is
+    *    then copied and deleted by FileHandle.
     */
     virtual bool move(AbstractFileHandleBackend & dest) = 0;
 
@@ -326,6 +419,50 @@ public:
     *    The created stream object has to be destroyed be the caller.
     */
     virtual std::unique_ptr<std::ostream> createOutputStream(std::ios_base::openmode mode) = 0;
+
+    /**
+    *  @brief
+    *    Replace file content atomically
+    *
+    *  @param[in] content
+    *    File content
+    *  @param[in] sync
+    *    Flush the file to disk before it replaces the old one?
+    *
+    *  @return
+    *    'true' if successful, 'false' if the generic implementation is to be used
+    *
+    *  @remarks
+    *    Backends can override this function to write the content to a
+    *    file that has no name until it is complete. The default
+    *    implementation returns 'false'.
+    */
+    virtual bool writeFileAtomic(const std::string & content, bool sync);
+
+    /**
+    *  @brief
+    *    Flush all written data of the file system that contains the file to disk
+    *
+    *  @return
+    *    'true' if successful, 'false' if not supported or on error
+    *
+    *  @remarks
+    *    The default implementation returns 'false'.
+    */
+    virtual bool syncFileSystem();
+
+    /**
+    *  @brief
+    *    Get ID of the device that contains the file
+    *
+    *  @return
+    *    Device ID, 0 if unknown
+    *
+    *  @remarks
+    *    Files with the same device ID are on the same file system.
+    *    The default implementation returns 0.
+    */
+    virtual unsigned long long deviceId() const;
 };
 
 
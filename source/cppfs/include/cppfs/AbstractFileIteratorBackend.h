@@ -21,6 +21,22 @@ class AbstractFileSystem;
 */
 class CPPFS_API AbstractFileIteratorBackend
 {
+public:
+    /**
+    *  @brief
+    *    Metadata of a directory item (symbolic links are not followed)
+    */
+    struct EntryInfo {
+        bool          isDirectory;      ///< Is the item a directory?
+        bool          isSymbolicLink;   ///< Is the item a symbolic link?
+        unsigned int  size;             ///< File size
+        unsigned int  modificationTime; ///< Time of last modification
+        unsigned long permissions;      ///< Permission bits of the file mode
+        unsigned int  userId;           ///< User ID
+        unsigned int  groupId;          ///< Group ID
+    };
+
+
 public:
     /**
     *  @brief
@@ -93,6 +109,24 @@ public:
     *    Advance to the next item
     */
     virtual void next() = 0;
+
+    /**
+    *  @brief
+    *    Get metadata of current directory item
+    *
+    *  @param[out] info
+    *    Metadata of the item
+    *
+    *  @return
+    *    'true' if the metadata is available, else 'false'
+    *
+    *  @remarks
+    *    Backends that receive metadata together with the directory
+    *    listing, or can query it relative to the open directory, return
+    *    it here, so no file handle has to be opened for the item.
+    *    The default implementation returns 'false'.
+    */
+    virtual bool entryInfo(EntryInfo & info) const;
 };
 
 
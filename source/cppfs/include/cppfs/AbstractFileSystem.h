@@ -4,8 +4,9 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
-#include <cppfs/cppfs_api.h>
+#include <cppfs/cppfs.h>
 
 
 namespace cppfs
@@ -14,6 +15,7 @@ namespace cppfs
 
 class FileHandle;
 class FileWatcher;
+class Tree;
 class AbstractFileWatcherBackend;
 
 
@@ -60,11 +62,56 @@ public:
     *
     *  @param[in] fileWatcher
     *    File watcher that owns the backend
+    *  @param[in] type
+    *    Requested type of watcher backend
     *
     *  @return
     *    Watcher backend (must NOT be null!)
+    *
+    *  @remarks
+    *    If the requested type of watcher is not supported, the
+    *    file system shall return its default watcher instead.
+    */
+    virtual std::unique_ptr<AbstractFileWatcherBackend> createFileWatcher(FileWatcher & fileWatcher, WatcherType type) = 0;
+
+    /**
+    *  @brief
+    *    Compute sha1 hashes for multiple files
+    *
+    *  @param[in] paths
+    *    Paths to files
+    *
+    *  @return
+    *    SHA1 hash for each file, "" if it could not be computed by the file system
+    *
+    *  @remarks
+    *    File systems can override this to compute hashes without reading
+    *    the files through cppfs, e.g., on a remote host. For files with an
+    *    empty hash, FileHandle::sha1() reads the file and computes the hash
+    *    itself. The default implementation returns empty hashes.
+    */
+    virtual std::vector<std::string> sha1(const std::vector<std::string> & paths);
+
+    /**
+    *  @brief
+    *    Read directory tree in one operation
+    *
+    *  @param[in] path
+    *    Path to file or directory
+    *  @param[in] treePath
+    *    File path for the root element
+    *
+    *  @return
+    *    File tree without hashes, nullptr if the file system cannot read it in one operation
+    *
+    *  @remarks
+    *    File systems can override this if they can list a whole tree
+    *    faster than by visiting each directory, e.g., by a single command
+    *    on a remote host. If nullptr is returned, FileHandle::readTree()
+    *    visits the directories itself. The default implementation returns
+    *    nullptr.
     */
-    virtual std::unique_ptr<AbstractFileWatcherBackend> createFileWatcher(FileWatcher & fileWatcher) = 0;
+    virtual std::unique_ptr<Tree> readTree(const std::string & path, const std::string & treePath);
 };
 
 
@@ -3,6 +3,7 @@
 
 
 #include <memory>
+#include <string>
 
 #include <cppfs/cppfs.h>
 
@@ -79,8 +80,66 @@ public:
     */
     virtual void watch(int timeout) = 0;
 
+    /**
+    *  @brief
+    *    Get native handle that can be used to wait for events
+    *
+    *  @return
+    *    File descriptor that becomes readable when events are pending, -1 if not supported
+    *
+    *  @remarks
+    *    The returned handle can be registered with an external event loop
+    *    (e.g., epoll or poll). When it becomes readable, processPending()
+    *    shall be called to dispatch the events. The handle is owned by the
+    *    backend and must not be closed or read from by the caller.
+    */
+    virtual int nativeHandle() const;
+
+    /**
+    *  @brief
+    *    Get events that are reported by the backend
+    *
+    *  @return
+    *    Combination of FileEvent values
+    *
+    *  @remarks
+    *    The default implementation returns FileCreated, FileRemoved,
+    *    FileModified and FileAttrChanged.
+    */
+    virtual unsigned int supportedEvents() const;
+
+    /**
+    *  @brief
+    *    Process all pending events without blocking
+    *
+    *  @remarks
+    *    The default implementation calls watch() with a timeout of zero.
+    */
+    virtual void processPending();
+
 
 protected:
+    /**
+    *  @brief
+    *    Called on each file event
+    *
+    *  @param[in] path
+    *    Path of the file or directory
+    *  @param[in] event
+    *    Type of event that has occured
+    *  @param[in] isDirectory
+    *    Has the event occured on a directory?
+    *  @param[in] cookie
+    *    Cookie that relates events of the same operation (0 if none)
+    *  @param[in] mask
+    *    Native event mask of the backend (0 if not available)
+    *
+    *  @remarks
+    *    Events are collected and passed to the event handlers
+    *    after watch() or processPending() have returned.
+    */
+    void onFileEvent(std::string path, FileEvent event, bool isDirectory = false, unsigned int cookie = 0, unsigned int mask = 0);
+
     /**
     *  @brief
     *    Called on each file event
@@ -92,6 +151,34 @@ protected:
     */
     void onFileEvent(FileHandle & fh, FileEvent event);
 
+    /**
+    *  @brief
+    *    Called when a file or directory has been moved or renamed
+    *
+    *  @param[in] from
+    *    Previous path
+    *  @param[in] to
+    *    New path
+    *  @param[in] isDirectory
+    *    Has a directory been moved?
+    *  @param[in] cookie
+    *    Cookie that relates events of the same operation (0 if none)
+    *  @param[in] mask
+    *    Native event mask of the backend (0 if not available)
+    */
+    void onFileMoved(std::string from, std::string to, bool isDirectory = false, unsigned int cookie = 0, unsigned int mask = 0);
+
+    /**
+    *  @brief
+    *    Called when a file or directory has been moved or renamed
+    *
+    *  @param[in] from
+    *    Handle to the previous location
+    *  @param[in] to
+    *    Handle to the new location
+    */
+    void onFileMoved(FileHandle & from, FileHandle & to);
+
 
 protected:
     FileWatcher * m_fileWatcher; ///< File watcher that owns the backend (never null)
@@ -0,0 +1,140 @@
+
+#pragma once
+
+
+#include <cstddef>
+
+#include <cppfs/cppfs.h>
+
+
+namespace cppfs
+{
+
+
+/**
+*  @brief
+*    Options for copying files
+*
+*  @remarks
+*    By default, files are copied sequentially by one thread. With
+*    more than one worker, the destination file is allocated first
+*    and ranges of chunk size bytes are copied concurrently, which
+*    helps to saturate fast disks and network links when copying
+*    single large files. Files that are smaller than two chunks are
+*    always copied sequentially. When copying directory trees, the
+*    workers copy different files concurrently instead.
+*
+*    Metadata and links are only preserved by backends that support
+*    it (local POSIX file systems, and SSH when copying directory
+*    trees on the remote host with 'cp').
+*/
+class CPPFS_API CopyOptions
+{
+public:
+    /**
+    *  @brief
+    *    Constructor
+    */
+    CopyOptions();
+
+    /**
+    *  @brief
+    *    Destructor
+    */
+    ~CopyOptions();
+
+    /**
+    *  @brief
+    *    Get number of workers
+    *
+    *  @return
+    *    Number of threads that copy ranges of a file concurrently
+    */
+    unsigned int workers() const;
+
+    /**
+    *  @brief
+    *    Set number of workers
+    *
+    *  @param[in] workers
+    *    Number of threads that copy ranges of a file concurrently (default: 1)
+    *
+    *  @return
+    *    Reference to this object
+    */
+    CopyOptions & setWorkers(unsigned int workers);
+
+    /**
+    *  @brief
+    *    Get chunk size
+    *
+    *  @return
+    *    Size of the ranges that are copied by the workers (in bytes)
+    */
+    size_t chunkSize() const;
+
+    /**
+    *  @brief
+    *    Set chunk size
+    *
+    *  @param[in] chunkSize
+    *    Size of the ranges that are copied by the workers (in bytes, default: 16 MiB)
+    *
+    *  @return
+    *    Reference to this object
+    */
+    CopyOptions & setChunkSize(size_t chunkSize);
+
+    /**
+    *  @brief
+    *    Check if metadata is preserved
+    *
+    *  @return
+    *    'true' if permissions, owner and times are copied, else 'false'
+    */
+    bool preserveMetadata() const;
+
+    /**
+    *  @brief
+    *    Set if metadata is preserved
+    *
+    *  @param[in] preserve
+    *    'true' to copy permissions, owner and times, else 'false' (default)
+    *
+    *  @return
+    *    Reference to this object
+    */
+    CopyOptions & setPreserveMetadata(bool preserve);
+
+    /**
+    *  @brief
+    *    Check if links are preserved
+    *
+    *  @return
+    *    'true' if links are re-created, 'false' if they are followed
+    */
+    bool preserveLinks() const;
+
+    /**
+    *  @brief
+    *    Set if links are preserved
+    *
+    *  @param[in] preserve
+    *    'true' to re-create symbolic links and hard links between copied
+    *    files, 'false' to copy the files they point to (default)
+    *
+    *  @return
+    *    Reference to this object
+    */
+    CopyOptions & setPreserveLinks(bool preserve);
+
+
+protected:
+    unsigned int m_workers;          ///< Number of threads that copy ranges of a file concurrently
+    size_t       m_chunkSize;        ///< Size of the ranges that are copied by the workers (in bytes)
+    bool         m_preserveMetadata; ///< Copy permissions, owner and times?
+    bool         m_preserveLinks;    ///< Re-create symbolic and hard links?
+};
+
+
+} // namespace cppfs
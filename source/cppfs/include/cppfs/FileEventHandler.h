@@ -2,6 +2,8 @@
 #pragma once
 
 
+#include <vector>
+
 #include <cppfs/cppfs.h>
 
 
@@ -10,6 +12,7 @@ namespace cppfs
 
 
 class FileHandle;
+class FileEventInfo;
 
 
 /**
@@ -39,6 +42,21 @@ public:
 
 
 protected:
+    /**
+    *  @brief
+    *    Called with all events that have been received at once
+    *
+    *  @param[in] events
+    *    List of events
+    *
+    *  @remarks
+    *    The default implementation opens a file handle for each event
+    *    and calls onFileEvent() or onFileMoved(). Handlers that process
+    *    large numbers of events can override this function to work on
+    *    the paths directly and avoid the per-event overhead.
+    */
+    virtual void onFileEvents(const std::vector<FileEventInfo> & events);
+
     /**
     *  @brief
     *    Called on file event
@@ -85,6 +103,30 @@ protected:
     *    Handle to file or directory
     */
     virtual void onFileAttrChanged(FileHandle & fh);
+
+    /**
+    *  @brief
+    *    Called when a file that was opened for writing has been closed
+    *
+    *  @param[in] fh
+    *    Handle to file
+    */
+    virtual void onFileClosedWrite(FileHandle & fh);
+
+    /**
+    *  @brief
+    *    Called when a file or directory has been moved or renamed
+    *
+    *  @param[in] from
+    *    Handle to the previous location of the file or directory
+    *  @param[in] to
+    *    Handle to the new location of the file or directory
+    *
+    *  @remarks
+    *    The default implementation calls onFileEvent() with
+    *    the new location and FileMoved as event type.
+    */
+    virtual void onFileMoved(FileHandle & from, FileHandle & to);
 };
 
 
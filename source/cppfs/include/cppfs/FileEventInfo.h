@@ -0,0 +1,213 @@
+
+#pragma once
+
+
+#include <string>
+#include <chrono>
+
+#include <cppfs/cppfs.h>
+
+
+namespace cppfs
+{
+
+
+class AbstractFileSystem;
+class FileHandle;
+
+
+/**
+*  @brief
+*    Description of one event on the file system
+*
+*  @remarks
+*    Events only store the path of the affected file. A file handle
+*    is created on request by calling fileHandle(), so handlers that
+*    are only interested in paths avoid the cost of opening them.
+*/
+class CPPFS_API FileEventInfo
+{
+public:
+    /**
+    *  @brief
+    *    Constructor
+    */
+    FileEventInfo();
+
+    /**
+    *  @brief
+    *    Constructor
+    *
+    *  @param[in] fs
+    *    File system on which the event occured (must NOT be null!)
+    *  @param[in] event
+    *    Type of event
+    *  @param[in] path
+    *    Path of the file or directory
+    *  @param[in] isDirectory
+    *    Has the event occured on a directory?
+    *  @param[in] cookie
+    *    Cookie that relates events of the same operation (0 if none)
+    *  @param[in] fromPath
+    *    Previous path of the file or directory (only for FileMoved)
+    *  @param[in] mask
+    *    Native event mask reported by the backend (0 if not available)
+    */
+    FileEventInfo(AbstractFileSystem * fs, FileEvent event, std::string path, bool isDirectory = false, unsigned int cookie = 0, std::string fromPath = "", unsigned int mask = 0);
+
+    /**
+    *  @brief
+    *    Copy constructor
+    *
+    *  @param[in] event
+    *    Other event
+    */
+    FileEventInfo(const FileEventInfo & event);
+
+    /**
+    *  @brief
+    *    Move constructor
+    *
+    *  @param[in] event
+    *    Other event
+    */
+    FileEventInfo(FileEventInfo && event);
+
+    /**
+    *  @brief
+    *    Destructor
+    */
+    ~FileEventInfo();
+
+    /**
+    *  @brief
+    *    Copy operator
+    *
+    *  @param[in] event
+    *    Other event
+    */
+    FileEventInfo & operator=(const FileEventInfo & event);
+
+    /**
+    *  @brief
+    *    Move operator
+    *
+    *  @param[in] event
+    *    Other event
+    */
+    FileEventInfo & operator=(FileEventInfo && event);
+
+    /**
+    *  @brief
+    *    Get file system
+    *
+    *  @return
+    *    File system on which the event occured (can be null)
+    */
+    AbstractFileSystem * fs() const;
+
+    /**
+    *  @brief
+    *    Get type of event
+    *
+    *  @return
+    *    Type of event
+    */
+    FileEvent event() const;
+
+    /**
+    *  @brief
+    *    Get path
+    *
+    *  @return
+    *    Path of the file or directory (new path for FileMoved)
+    */
+    const std::string & path() const;
+
+    /**
+    *  @brief
+    *    Get previous path
+    *
+    *  @return
+    *    Previous path of the file or directory for FileMoved, else empty
+    */
+    const std::string & fromPath() const;
+
+    /**
+    *  @brief
+    *    Check if the event has occured on a directory
+    *
+    *  @return
+    *    'true' if the backend reported a directory, else 'false'
+    *
+    *  @remarks
+    *    Not all backends know the type of the file without querying it.
+    *    In this case, 'false' is returned and fileHandle() can be used
+    *    to query the type.
+    */
+    bool isDirectory() const;
+
+    /**
+    *  @brief
+    *    Get cookie
+    *
+    *  @return
+    *    Cookie that relates events of the same operation (0 if none)
+    */
+    unsigned int cookie() const;
+
+    /**
+    *  @brief
+    *    Get native event mask
+    *
+    *  @return
+    *    Event mask as reported by the backend (0 if not available)
+    *
+    *  @remarks
+    *    The meaning of the mask depends on the backend, e.g., IN_* flags
+    *    for inotify and FAN_* flags for fanotify. Polling backends do not
+    *    have a native mask and report 0.
+    */
+    unsigned int mask() const;
+
+    /**
+    *  @brief
+    *    Get time at which the event has been received
+    *
+    *  @return
+    *    Timestamp
+    */
+    std::chrono::steady_clock::time_point timestamp() const;
+
+    /**
+    *  @brief
+    *    Open file or directory
+    *
+    *  @return
+    *    File handle for path()
+    */
+    FileHandle fileHandle() const;
+
+    /**
+    *  @brief
+    *    Open previous location of the file or directory
+    *
+    *  @return
+    *    File handle for fromPath()
+    */
+    FileHandle fromFileHandle() const;
+
+
+protected:
+    AbstractFileSystem *                  m_fs;          ///< File system on which the event occured (can be null)
+    FileEvent                             m_event;       ///< Type of event
+    std::string                           m_path;        ///< Path of the file or directory
+    std::string                           m_fromPath;    ///< Previous path (only for FileMoved)
+    bool                                  m_isDirectory; ///< Has the event occured on a directory?
+    unsigned int                          m_cookie;      ///< Cookie that relates events of the same operation
+    unsigned int                          m_mask;        ///< Native event mask reported by the backend
+    std::chrono::steady_clock::time_point m_timestamp;   ///< Time at which the event has been received
+};
+
+
+} // namespace cppfs
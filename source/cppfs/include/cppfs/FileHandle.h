@@ -9,6 +9,7 @@
 #include <string>
 
 #include <cppfs/cppfs.h>
+#include <cppfs/CopyOptions.h>
 #include <cppfs/AbstractFileHandleBackend.h>
 
 
@@ -226,7 +227,7 @@ public:
     *  @param[in] path
     *    File path for the root element
     *  @param[in] includeHash
-    *    Compute SHA1 hash of each file? (slow, as each will must be read entirely)
+    *    Compute SHA1 hash of each file? (slow, as each file must be read entirely, unless the file system can compute hashes itself)
     *
     *  @return
     *    File tree, nullptr if this file does not exist
@@ -399,6 +400,11 @@ public:
     *
     *  @param[in] dstDir
     *    Destination directory
+    *  @param[in] options
+    *    Copy options
+    *
+    *  @return
+    *    'true' if all entries have been copied, else 'false'
     *
     *  @remarks
     *    Destination directory points to the actual directory that
@@ -407,8 +413,45 @@ public:
     *    Example:
     *      FileHandle dir = fs::open("/projects/project1");
     *      dir.copyDirectory(fs::open("/backup/projects/project1"))
+    *
+    *    If both directories are on the same file system, the backend
+    *    may copy the tree in one operation (e.g., on the remote host
+    *    for SSH, or with several threads for local file systems).
+    *    Otherwise, or if the backend fails to copy an entry, entries
+    *    are copied one by one and links are followed. Broken links and
+    *    entries that are neither files nor directories are skipped.
+    */
+    bool copyDirectoryRec(FileHandle & dstDir, const CopyOptions & options = CopyOptions());
+
+    /**
+    *  @brief
+    *    Clone directory recursively
+    *
+    *  @param[in] dstDir
+    *    Destination directory
+    *  @param[in] options
+    *    Copy options
+    *  @param[out] clonedBytes
+    *    Receives the number of bytes that have been cloned (can be null)
+    *  @param[out] copiedBytes
+    *    Receives the number of bytes that had to be copied (can be null)
+    *
+    *  @return
+    *    'true' if the tree has been cloned, 'false' if cloning is not supported or an entry could not be copied
+    *
+    *  @remarks
+    *    Creates the directory structure at the destination and clones
+    *    each file, so that it shares its data with the original until
+    *    one of them is modified (e.g., with FICLONE on Btrfs or XFS).
+    *    This makes snapshots of large trees almost free. Files that
+    *    cannot be cloned (e.g., because the file system does not
+    *    support it) are copied instead.
+    *
+    *    Cloning is supported for local file systems on Linux. If it is
+    *    not supported for the given handles (e.g., they are on different
+    *    file systems), nothing is copied and copyDirectoryRec can be used.
     */
-    void copyDirectoryRec(FileHandle & dstDir);
+    bool cloneDirectory(FileHandle & dstDir, const CopyOptions & options = CopyOptions(), unsigned long long * clonedBytes = nullptr, unsigned long long * copiedBytes = nullptr);
 
     /**
     *  @brief
@@ -419,29 +462,57 @@ public:
     */
     void removeDirectoryRec(bool followSymlinks=false);
 
+    /**
+    *  @brief
+    *    Remove directory recursively in the background
+    *
+    *  @return
+    *    'true' if the directory is gone from its path, else 'false'
+    *
+    *  @remarks
+    *    On local POSIX file systems, the directory is renamed to a hidden
+    *    name next to it ('.cppfs-trash-...') and deleted by a background
+    *    thread, so the call returns immediately. Use fs::pendingRemovals()
+    *    and fs::waitForRemovals() to query or wait for pending deletions.
+    *    When the program exits, pending deletions are continued for at most
+    *    two seconds. Trash that is left behind is collected in the background
+    *    when a process removes another directory next to it. Other backends
+    *    remove the directory synchronously. Symbolic links are not followed.
+    */
+    bool removeDirectoryRecAsync();
+
     /**
     *  @brief
     *    Copy file
     *
     *  @param[in] dest
     *    Destination file or directory
+    *  @param[in] options
+    *    Copy options
     *
     *  @return
     *    'true' if successful, else 'false'
     */
-    bool copy(FileHandle & dest);
+    bool copy(FileHandle & dest, const CopyOptions & options = CopyOptions());
 
     /**
     *  @brief
-    *    Move file
+    *    Move file or directory
     *
     *  @param[in] dest
     *    Destination file or directory
+    *  @param[in] options
+    *    Copy options (used if the data has to be copied)
     *
     *  @return
     *    'true' if successful, else 'false'
+    *
+    *  @remarks
+    *    Within a file system, files and directories are renamed. If the
+    *    destination is on another device or file system, the data is
+    *    copied and the source is removed afterwards (see genericMove).
     */
-    bool move(FileHandle & dest);
+    bool move(FileHandle & dest, const CopyOptions & options = CopyOptions());
 
     /**
     *  @brief
@@ -575,31 +646,124 @@ public:
     */
     bool writeFileBase64(const std::string & base64);
 
+    /**
+    *  @brief
+    *    Replace file content atomically
+    *
+    *  @param[in] content
+    *    File content
+    *  @param[in] sync
+    *    Flush the file to disk before it replaces the old one?
+    *
+    *  @return
+    *    'true' on success, else 'false'
+    *
+    *  @remarks
+    *    Unlike writeFile, readers see either the old or the new content,
+    *    and a crash never leaves a partially written file under the name.
+    *    The permissions of an existing file are kept.
+    *
+    *    On Linux, the content is written to an unnamed file (O_TMPFILE),
+    *    which gets its name with linkat once it is complete and then
+    *    replaces the old file with rename. Other backends write a hidden
+    *    file next to it (see FileWriteBatch). To replace many files, use
+    *    FileWriteBatch, which flushes all of them at once.
+    *
+    *    On local POSIX file systems, symbolic links are followed, so the
+    *    file they point to is replaced and the link is kept. Other backends
+    *    reject symbolic links.
+    */
+    bool writeFileAtomic(const std::string & content, bool sync = false);
+
+    /**
+    *  @brief
+    *    Flush all written data of the file system that contains the file to disk
+    *
+    *  @return
+    *    'true' on success, 'false' if not supported or on error
+    *
+    *  @remarks
+    *    Uses syncfs on Linux, sync on other POSIX systems and runs
+    *    'sync' on the remote host for SSH. Not supported on Windows.
+    */
+    bool syncFileSystem();
+
+    /**
+    *  @brief
+    *    Get ID of the device that contains the file
+    *
+    *  @return
+    *    Device ID, 0 if unknown or not supported
+    *
+    *  @remarks
+    *    Files on the same file system and with the same device ID share
+    *    one syncFileSystem(). Only supported on local POSIX file systems.
+    */
+    unsigned long long deviceId() const;
+
 
 protected:
+    /**
+    *  @brief
+    *    Compute sha1 hash for file by reading it
+    *
+    *  @return
+    *    SHA1 hash, "" on error
+    */
+    std::string computeSha1() const;
+
     /**
     *  @brief
     *    Copy file by stream copy
     *
     *  @param[in] dest
     *    Destination file or directory
+    *  @param[in] options
+    *    Copy options
     *
     *  @return
     *    'true' if successful, else 'false'
+    *
+    *  @remarks
+    *    While a large file is copied, the progress is recorded in a
+    *    file next to the destination ('<dest>.cppfs-progress'). If the
+    *    copy is interrupted, the next copy of the same source file
+    *    continues at the recorded offset, after comparing the data
+    *    before it with the source file. The destination file is only
+    *    truncated if the source file has changed or the data differs.
+    *
+    *    The source file is read on a separate thread into a ring of
+    *    buffers, so that reading and writing overlap.
+    *
+    *    With more than one worker, large files are copied in ranges by
+    *    several threads instead, each using its own streams (for SSH,
+    *    this means its own SFTP handle). Such copies are not resumable.
     */
-    bool genericCopy(FileHandle & dest);
+    bool genericCopy(FileHandle & dest, const CopyOptions & options = CopyOptions());
 
     /**
     *  @brief
-    *    Move file by stream copy and delete
+    *    Move file or directory by copy and delete
     *
     *  @param[in] dest
     *    Destination file or directory
+    *  @param[in] options
+    *    Copy options
     *
     *  @return
     *    'true' if successful, else 'false'
-    */
-    bool genericMove(FileHandle & dest);
+    *
+    *  @remarks
+    *    The data is copied to a hidden name next to the destination
+    *    ('.<name>.cppfs-moving') with copy or copyDirectoryRec, so
+    *    the fastest available copy is used. Directory trees are copied
+    *    with their metadata and links. The copy is compared with the
+    *    source (entries and file sizes) and renamed to the destination
+    *    name, so that partially moved data never appears under it.
+    *    Only then is the source removed. An existing destination file
+    *    is replaced, an existing destination directory is not.
+    */
+    bool genericMove(FileHandle & dest, const CopyOptions & options = CopyOptions());
 
 
 protected:
@@ -6,6 +6,7 @@
 #include <string>
 
 #include <cppfs/cppfs_api.h>
+#include <cppfs/AbstractFileIteratorBackend.h>
 
 
 namespace cppfs
@@ -13,7 +14,6 @@ namespace cppfs
 
 
 class AbstractFileSystem;
-class AbstractFileIteratorBackend;
 
 
 /**
@@ -119,6 +119,19 @@ public:
     */
     AbstractFileSystem * fs() const;
 
+    /**
+    *  @brief
+    *    Get metadata of current directory item
+    *
+    *  @param[out] info
+    *    Metadata of the item
+    *
+    *  @return
+    *    'true' if the backend provides the metadata with the listing,
+    *    'false' if the item has to be opened to query it
+    */
+    bool entryInfo(AbstractFileIteratorBackend::EntryInfo & info) const;
+
 
 protected:
     std::unique_ptr<AbstractFileIteratorBackend> m_backend;
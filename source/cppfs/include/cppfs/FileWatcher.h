@@ -3,10 +3,14 @@
 
 
 #include <vector>
+#include <map>
+#include <string>
 #include <memory>
+#include <chrono>
 #include <functional>
 
 #include <cppfs/cppfs.h>
+#include <cppfs/FileEventInfo.h>
 #include <cppfs/AbstractFileWatcherBackend.h>
 #include <cppfs/FunctionalFileEventHandler.h>
 
@@ -52,12 +56,15 @@ public:
     *
     *  @param[in] fs
     *    Filesystem for which the watcher is created (can be null)
+    *  @param[in] type
+    *    Type of watcher backend
     *
     *  @remarks
     *    If fs == nullptr, the watcher will not be usable with any
-    *    file system handles.
+    *    file system handles. If the requested type of watcher is not
+    *    supported by the file system, its default watcher is used.
     */
-    FileWatcher(AbstractFileSystem * fs);
+    FileWatcher(AbstractFileSystem * fs, WatcherType type = DefaultWatcher);
 
     /**
     *  @brief
@@ -118,6 +125,51 @@ public:
     */
     AbstractFileSystem * fs() const;
 
+    /**
+    *  @brief
+    *    Get backend
+    *
+    *  @return
+    *    Backend implementation (can be null)
+    *
+    *  @remarks
+    *    Can be used to configure options of specific backends,
+    *    e.g., the poll interval of a PollingFileWatcher.
+    */
+    AbstractFileWatcherBackend * backend() const;
+
+    /**
+    *  @brief
+    *    Get settle time
+    *
+    *  @return
+    *    Settle time in milliseconds (0 if disabled)
+    */
+    int settleTime() const;
+
+    /**
+    *  @brief
+    *    Set settle time
+    *
+    *  @param[in] settleTime
+    *    Settle time in milliseconds (0 to disable)
+    *
+    *  @remarks
+    *    Backends that cannot report FileClosedWrite natively (see
+    *    AbstractFileWatcherBackend::supportedEvents()) can emulate it
+    *    by settle detection: A file for which no FileCreated or
+    *    FileModified event has been received for the given time is
+    *    reported as FileClosedWrite. While this is active, watching
+    *    FileClosedWrite also watches FileCreated and FileModified.
+    *
+    *    Settled files are only reported from within watch() and
+    *    processPending(). When using nativeHandle(), processPending()
+    *    therefore also has to be called periodically.
+    *
+    *    This must be set before directories are added to the watcher.
+    */
+    void setSettleTime(int settleTime);
+
     /**
     *  @brief
     *    Watch directory
@@ -133,8 +185,13 @@ public:
     *    The file handle must belong to the same file system as the
     *    file watcher, otherwise it will be ignored. Therefore, one
     *    file watcher object can only be used to watch files on a
-    *    single file system. Also note that file watching is not
-    *    supported for remote file systems, such as SSH.
+    *    single file system. Remote file systems, such as SSH,
+    *    are watched by polling (see PollingFileWatcher).
+    *
+    *    FileMoved is not watched by default. If it is not watched, or if
+    *    a file is moved into or out of the watched directories, a move is
+    *    reported as FileRemoved and/or FileCreated instead (if these events
+    *    are watched).
     */
     void add(FileHandle & dir, unsigned int events = FileCreated | FileRemoved | FileModified | FileAttrChanged, RecursiveMode recursive = Recursive);
 
@@ -187,8 +244,48 @@ public:
     */
     void watch(int timeout = -1);
 
+    /**
+    *  @brief
+    *    Get native handle that can be used to wait for events
+    *
+    *  @return
+    *    File descriptor that becomes readable when events are pending, -1 if not supported
+    *
+    *  @remarks
+    *    This allows to integrate the file watcher into an existing event
+    *    loop instead of calling watch(). Register the handle for readability
+    *    (e.g., with epoll or poll) and call processPending() when it becomes
+    *    readable. The handle remains owned by the file watcher.
+    */
+    int nativeHandle() const;
+
+    /**
+    *  @brief
+    *    Process all pending events without blocking
+    *
+    *  @remarks
+    *    Calls onFileEvent() for every event that is currently queued
+    *    and returns immediately if there are none.
+    */
+    void processPending();
+
 
 protected:
+    /**
+    *  @brief
+    *    Called with all events that have been received at once
+    *
+    *  @param[in] events
+    *    List of events
+    *
+    *  @remarks
+    *    The default implementation calls onFileEvent() or onFileMoved()
+    *    for each event and then passes the events to the registered
+    *    event handlers. File handles are only opened for these calls if
+    *    a derived class overrides onFileEvent() or onFileMoved().
+    */
+    virtual void onFileEvents(const std::vector<FileEventInfo> & events);
+
     /**
     *  @brief
     *    Called on file event
@@ -199,15 +296,90 @@ protected:
     *    Type of event that has occured
     *
     *  @remarks
-    *    The default implementation checks the event and calls
-    *    the registered callback functions.
+    *    Called by the default implementation of onFileEvents() before
+    *    the events are passed to the registered event handlers.
+    *    The default implementation does nothing and stops further calls,
+    *    so overriding functions must not call it.
     */
     virtual void onFileEvent(FileHandle & fh, FileEvent event);
 
+    /**
+    *  @brief
+    *    Called when a file or directory has been moved or renamed
+    *
+    *  @param[in] from
+    *    Handle to the previous location
+    *  @param[in] to
+    *    Handle to the new location
+    *
+    *  @remarks
+    *    Called by the default implementation of onFileEvents() before
+    *    the events are passed to the registered event handlers.
+    *    The default implementation does nothing and stops further calls,
+    *    so overriding functions must not call it.
+    */
+    virtual void onFileMoved(FileHandle & from, FileHandle & to);
+
+    /**
+    *  @brief
+    *    Add event to the list of received events
+    *
+    *  @param[in] event
+    *    File event
+    */
+    void queueEvent(FileEventInfo && event);
+
+    /**
+    *  @brief
+    *    Pass all received events to onFileEvents()
+    */
+    void dispatchEvents();
+
+    /**
+    *  @brief
+    *    Get time until the next file settles
+    *
+    *  @param[in] timeout
+    *    Timeout value in milliseconds (less than zero for infinite)
+    *
+    *  @return
+    *    Timeout limited to the time until the next file settles
+    */
+    int settleTimeout(int timeout) const;
+
+    /**
+    *  @brief
+    *    Add FileClosedWrite events for all files that have settled
+    */
+    void queueSettledFiles();
+
+    /**
+    *  @brief
+    *    Check if an event has been requested for a directory that contains the file
+    *
+    *  @param[in] event
+    *    File event
+    *
+    *  @return
+    *    'true' if the event is watched, 'false' if it has only been requested for settle detection
+    */
+    bool isWatched(const FileEventInfo & event) const;
+
 
 protected:
-    std::unique_ptr<AbstractFileWatcherBackend> m_backend;       ///< Backend implementation (can be null)
-    std::vector<FileEventHandler *>             m_eventHandlers; ///< List of registered file event handlers
+    std::unique_ptr<AbstractFileWatcherBackend> m_backend;            ///< Backend implementation (can be null)
+    std::vector<FileEventHandler *>             m_eventHandlers;      ///< List of registered file event handlers
+    int                                         m_settleTime;         ///< Settle time in milliseconds (0 if disabled)
+    bool                                        m_emulateClosedWrite; ///< Is FileClosedWrite emulated by settle detection?
+    bool                                        m_fileEventHook;      ///< Is onFileEvent() overridden? (cleared by the default implementation)
+    bool                                        m_fileMovedHook;      ///< Is onFileMoved() overridden? (cleared by the default implementation)
+    std::vector<FileEventInfo>                  m_events;             ///< Events that have been received, but not yet dispatched
+
+    /// Files waiting to settle (path -> time of the last event)
+    std::map<std::string, std::chrono::steady_clock::time_point> m_settlingFiles;
+
+    /// Events requested by the caller for each watched directory (path -> events)
+    std::map<std::string, unsigned int> m_watchedEvents;
 
     /// Functional event handlers that are owned by the file watcher
     std::vector< std::unique_ptr<FunctionalFileEventHandler> > m_ownEventHandlers;
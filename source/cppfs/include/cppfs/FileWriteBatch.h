@@ -0,0 +1,143 @@
+
+#pragma once
+
+
+#include <string>
+#include <vector>
+
+#include <cppfs/FileHandle.h>
+
+
+namespace cppfs
+{
+
+
+/**
+*  @brief
+*    Atomic replacement of the content of many files
+*
+*  @remarks
+*    Each added file is written to a hidden file next to it
+*    ('.<name>.cppfs-...'). On commit, the written data is flushed to
+*    disk once per file system instead of once per file (group commit),
+*    and then each hidden file replaces its destination with rename.
+*    Readers therefore see either the old or the new content of each
+*    file, never a partially written one. The files are replaced one
+*    after another, not all at once.
+*
+*    Hidden files of a batch that has not been committed are removed
+*    when the batch is destroyed.
+*/
+class CPPFS_API FileWriteBatch
+{
+public:
+    /**
+    *  @brief
+    *    Constructor
+    *
+    *  @param[in] sync
+    *    Flush the files to disk before they replace the old ones?
+    */
+    FileWriteBatch(bool sync = true);
+
+    /**
+    *  @brief
+    *    Copy constructor (deleted)
+    *
+    *  @param[in] batch
+    *    Source batch
+    *
+    *  @remarks
+    *    Batches cannot be copied, as both copies would commit or
+    *    discard the same hidden files.
+    */
+    FileWriteBatch(const FileWriteBatch & batch) = delete;
+
+    /**
+    *  @brief
+    *    Destructor
+    */
+    ~FileWriteBatch();
+
+    /**
+    *  @brief
+    *    Copy operator (deleted)
+    *
+    *  @param[in] batch
+    *    Source batch
+    *
+    *  @remarks
+    *    Batches cannot be copied, as both copies would commit or
+    *    discard the same hidden files.
+    */
+    FileWriteBatch & operator=(const FileWriteBatch & batch) = delete;
+
+    /**
+    *  @brief
+    *    Write content for a file
+    *
+    *  @param[in] file
+    *    File that is replaced on commit
+    *  @param[in] content
+    *    File content
+    *
+    *  @return
+    *    'true' if the content has been written, else 'false'
+    *
+    *  @remarks
+    *    Symbolic links are rejected, as renaming the hidden file
+    *    would replace the link instead of the file it points to.
+    */
+    bool add(const FileHandle & file, const std::string & content);
+
+    /**
+    *  @brief
+    *    Replace all files that have been added
+    *
+    *  @return
+    *    'true' if all files have been replaced, else 'false'
+    *
+    *  @remarks
+    *    If a file cannot be replaced, the remaining files are discarded.
+    *    Files that have already been replaced keep their new content.
+    */
+    bool commit();
+
+
+protected:
+    /**
+    *  @brief
+    *    File that has been written, but not replaced yet
+    */
+    struct Entry
+    {
+        FileHandle file; ///< File that is replaced
+        FileHandle temp; ///< Hidden file with the new content
+    };
+
+
+protected:
+    /**
+    *  @brief
+    *    Flush each file system that contains files of the batch once
+    *
+    *  @return
+    *    'true' if successful, else 'false'
+    */
+    bool syncDirectories();
+
+    /**
+    *  @brief
+    *    Remove hidden files that have not been committed
+    */
+    void discard();
+
+
+protected:
+    bool               m_sync;    ///< Flush the files to disk before they replace the old ones?
+    std::string        m_id;      ///< Random part of the names of the hidden files
+    std::vector<Entry> m_entries; ///< Written files
+};
+
+
+} // namespace cppfs
@@ -0,0 +1,209 @@
+
+#pragma once
+
+
+#include <memory>
+#include <map>
+#include <deque>
+#include <string>
+#include <chrono>
+
+#include <cppfs/AbstractFileWatcherBackend.h>
+
+
+namespace cppfs
+{
+
+
+class AbstractFileSystem;
+
+
+/**
+*  @brief
+*    File watcher that detects changes by comparing snapshots
+*
+*  @remarks
+*    This backend works on every file system, including remote ones
+*    such as SSH. It periodically lists the watched directories, compares
+*    the metadata of their entries (type, size, modification time,
+*    permissions and owner) with the previous snapshot and reports the
+*    differences as file events. File contents are never read.
+*
+*    The poll interval adapts to the activity on the file system: after
+*    a change has been found, directories are polled again after the
+*    minimum interval. While nothing changes, the interval is doubled
+*    up to the maximum interval.
+*
+*    To limit the load on the file system, a poll cycle stops after the
+*    given number of entries has been examined (stat budget) and the
+*    next cycle continues with the remaining directories. A directory is
+*    always examined as a whole, so a single large directory can exceed
+*    the budget. The same applies to the initial snapshot of directories
+*    that are added: the rest of a large tree is examined in the following
+*    poll cycles. Changes in a subdirectory before it has been examined
+*    for the first time are not reported.
+*
+*    Where the backend provides metadata with the directory listing
+*    (local POSIX file systems and SSH), no file handle is opened per
+*    entry.
+*
+*    Moves cannot be detected and are reported as FileRemoved and
+*    FileCreated. The contents of directories that exist when they are
+*    added are not reported, the contents of directories that are
+*    created later are reported as FileCreated.
+*/
+class CPPFS_API PollingFileWatcher : public AbstractFileWatcherBackend
+{
+public:
+    /**
+    *  @brief
+    *    Constructor
+    *
+    *  @param[in] fileWatcher
+    *    File watcher that owns the backend (must NOT be null!)
+    *  @param[in] fs
+    *    File system that created this watcher
+    */
+    PollingFileWatcher(FileWatcher * fileWatcher, std::shared_ptr<AbstractFileSystem> fs);
+
+    /**
+    *  @brief
+    *    Destructor
+    */
+    virtual ~PollingFileWatcher();
+
+    /**
+    *  @brief
+    *    Set poll interval
+    *
+    *  @param[in] minInterval
+    *    Interval after a change has been found (in milliseconds)
+    *  @param[in] maxInterval
+    *    Interval after a long time without changes (in milliseconds)
+    */
+    void setPollInterval(int minInterval, int maxInterval);
+
+    /**
+    *  @brief
+    *    Get minimum poll interval
+    *
+    *  @return
+    *    Interval in milliseconds
+    */
+    int minPollInterval() const;
+
+    /**
+    *  @brief
+    *    Get maximum poll interval
+    *
+    *  @return
+    *    Interval in milliseconds
+    */
+    int maxPollInterval() const;
+
+    /**
+    *  @brief
+    *    Set stat budget
+    *
+    *  @param[in] budget
+    *    Maximum number of entries that are examined per poll cycle (0 for unlimited)
+    */
+    void setStatBudget(unsigned int budget);
+
+    /**
+    *  @brief
+    *    Get stat budget
+    *
+    *  @return
+    *    Maximum number of entries that are examined per poll cycle (0 for unlimited)
+    */
+    unsigned int statBudget() const;
+
+    // Virtual AbstractFileWatcherBackend functions
+    virtual AbstractFileSystem * fs() const override;
+    virtual void add(FileHandle & dir, unsigned int events, RecursiveMode recursive) override;
+    virtual void watch(int timeout) override;
+
+
+protected:
+    /**
+    *  @brief
+    *    Metadata of a directory entry
+    */
+    struct Entry {
+        bool          isDirectory; ///< Is the entry a directory?
+        unsigned int  size;        ///< File size
+        unsigned int  modTime;     ///< Time of last modification
+        unsigned long permissions; ///< File permissions
+        unsigned int  uid;         ///< User ID
+        unsigned int  gid;         ///< Group ID
+    };
+
+    /**
+    *  @brief
+    *    Snapshot of a watched directory
+    */
+    struct Directory {
+        unsigned int                  events;    ///< Watched events
+        RecursiveMode                 recursive; ///< Watch subdirectories?
+        bool                          scanned;   ///< Has the directory been scanned before?
+        bool                          report;    ///< Report the contents found by the first scan?
+        std::map<std::string, Entry>  entries;   ///< Directory entries (name -> metadata)
+    };
+
+
+protected:
+    /**
+    *  @brief
+    *    Run one poll cycle
+    *
+    *  @return
+    *    Number of events that have been found
+    *
+    *  @remarks
+    *    Starts a new pass over all watched directories if the previous
+    *    one has been completed, and scans directories until the stat
+    *    budget is used up.
+    */
+    unsigned int poll();
+
+    /**
+    *  @brief
+    *    Scan directory and compare it with its previous snapshot
+    *
+    *  @param[in] path
+    *    Path of the directory
+    *  @param[in,out] stats
+    *    Number of entries that have been examined (incremented)
+    *  @param[in,out] queue
+    *    Queue of directories to scan, new subdirectories are appended
+    *
+    *  @return
+    *    Number of events that have been found
+    */
+    unsigned int scan(const std::string & path, unsigned int & stats, std::deque<std::string> & queue);
+
+    /**
+    *  @brief
+    *    Forget snapshots of a directory and its subdirectories
+    *
+    *  @param[in] path
+    *    Path of the directory
+    */
+    void removeDirectory(const std::string & path);
+
+
+protected:
+    std::shared_ptr<AbstractFileSystem>   m_fs;          ///< File system that created this watcher
+    std::map<std::string, Directory>      m_dirs;        ///< Watched directories (path -> snapshot)
+    std::deque<std::string>               m_queue;       ///< Directories that are not yet scanned in the current pass
+    int                                   m_minInterval; ///< Minimum poll interval (in milliseconds)
+    int                                   m_maxInterval; ///< Maximum poll interval (in milliseconds)
+    int                                   m_interval;    ///< Current poll interval (in milliseconds)
+    unsigned int                          m_statBudget;  ///< Maximum number of entries per poll cycle (0 for unlimited)
+    bool                                  m_changed;     ///< Has a change been found in the current pass?
+    std::chrono::steady_clock::time_point m_nextPoll;    ///< Time of the next poll cycle
+};
+
+
+} // namespace cppfs
@@ -38,7 +38,20 @@ enum FileEvent
     FileCreated     = 0x01, ///< A file or directory has been created
     FileRemoved     = 0x02, ///< A file or directory has been removed
     FileModified    = 0x04, ///< A file or directory has been modified
-    FileAttrChanged = 0x08  ///< Attributes on a file or directory have been modified
+    FileAttrChanged = 0x08, ///< Attributes on a file or directory have been modified
+    FileMoved       = 0x10, ///< A file or directory has been moved or renamed
+    FileClosedWrite = 0x20  ///< A file that was opened for writing has been closed
+};
+
+/**
+*  @brief
+*    Type of backend that is used by a file watcher
+*/
+enum WatcherType
+{
+    DefaultWatcher = 0, ///< Default watcher of the file system (e.g., inotify on Linux)
+    FanotifyWatcher,    ///< Watch whole file systems with a single registration (Linux only, falls back to the default watcher if not available)
+    PollingWatcher      ///< Detect changes by periodically comparing snapshots (works on every file system)
 };
 
 /**
@@ -44,9 +44,61 @@ CPPFS_API std::shared_ptr<AbstractFileSystem> localFS();
 *
 *  @return
 *    File handle
+*
+*  @remarks
+*    For remote file systems, the credentials can also contain
+*    connection options (see SshFileSystem).
+*
+*    Connections to remote file systems are shared: opening another
+*    path with the same host, port, user, password, key files and
+*    options reuses the existing connection. A connection is kept open
+*    for some time after the last call, even if no handle uses it
+*    anymore, and is checked before it is reused after being idle.
+*    The following options control this behavior:
+*      - reuse: Set to "false" to open a private connection (default: "true")
+*      - idleTimeout: Time to keep an unused connection open (in seconds, default: 60)
+*
+*    The idle timeout is applied lazily: there is no background timer,
+*    so a connection whose timeout has expired is closed by the next call
+*    of open() (for any path) or by releaseConnections().
+*
+*    Shared connections can be used by multiple threads at once (see
+*    SshFileSystem). Their operations run in parallel only if the
+*    connection may open several sessions (option 'sessions').
 */
 CPPFS_API FileHandle open(const std::string & path, const LoginCredentials * credentials = nullptr);
 
+/**
+*  @brief
+*    Release connections to remote file systems that are kept open for reuse
+*
+*  @remarks
+*    Connections that are still used by file handles stay open until
+*    the last handle has been destroyed, but are not reused anymore.
+*/
+CPPFS_API void releaseConnections();
+
+/**
+*  @brief
+*    Get number of directories that are removed in the background
+*
+*  @return
+*    Number of pending removals started by FileHandle::removeDirectoryRecAsync()
+*/
+CPPFS_API unsigned int pendingRemovals();
+
+/**
+*  @brief
+*    Wait until directories that are removed in the background are gone
+*
+*  @param[in] timeout
+*    Timeout in milliseconds (less than zero for infinite)
+*
+*  @return
+*    'true' if no removals are pending, 'false' if the timeout has expired
+*/
+CPPFS_API bool waitForRemovals(int timeout = -1);
+
 /**
 *  @brief
 *    Compute sha1 hash for string
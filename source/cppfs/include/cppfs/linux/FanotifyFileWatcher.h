@@ -0,0 +1,154 @@
+
+#pragma once
+
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cppfs/linux/LocalFileWatcher.h>
+
+
+namespace cppfs
+{
+
+
+class LocalFileSystem;
+
+
+/**
+*  @brief
+*    File watcher for the local file system based on fanotify
+*
+*  @remarks
+*    Recursive watches are registered with a single mark for the entire
+*    file system instead of one inotify watch per directory, so they are
+*    not limited by max_user_watches. Events are filtered by the watched
+*    subtrees before they are reported.
+*
+*    Marking a file system requires CAP_SYS_ADMIN and Linux 5.9 or newer.
+*    FileMoved requires FAN_RENAME (Linux 5.17), as older kernels report
+*    the two halves of a move without a cookie that relates them. On
+*    these kernels, directories for which FileMoved is watched are
+*    watched with inotify, so supportedEvents() stays valid. Directories
+*    that cannot be watched by fanotify are watched with inotify instead.
+*    Both descriptors are combined in an epoll instance, which is returned
+*    by nativeHandle(). If no epoll instance can be created, fanotify is
+*    not used at all.
+*/
+class CPPFS_API FanotifyFileWatcher : public LocalFileWatcher
+{
+public:
+    /**
+    *  @brief
+    *    Constructor
+    *
+    *  @param[in] fileWatcher
+    *    File watcher that owns the backend (must NOT be null!)
+    *  @param[in] fs
+    *    File system that created this watcher
+    */
+    FanotifyFileWatcher(FileWatcher * fileWatcher, std::shared_ptr<LocalFileSystem> fs);
+
+    /**
+    *  @brief
+    *    Destructor
+    */
+    virtual ~FanotifyFileWatcher();
+
+    // Virtual AbstractFileWatcherBackend functions
+    virtual void add(FileHandle & dir, unsigned int events, RecursiveMode recursive) override;
+    virtual void watch(int timeout) override;
+    virtual int nativeHandle() const override;
+    virtual void processPending() override;
+
+
+protected:
+    /**
+    *  @brief
+    *    Directory watched by fanotify
+    */
+    struct Mark {
+        FileHandle    dir;       ///< Directory that is watched
+        std::string   path;      ///< Absolute path to the directory
+        unsigned int  events;    ///< Watched events
+        RecursiveMode recursive; ///< Watch recursively?
+        int           dirFd;     ///< Descriptor of the directory (used to resolve file handles)
+        std::string   fsid;      ///< ID of the file system the directory resides on
+        std::string   handle;    ///< File handle of the directory
+    };
+
+
+protected:
+    /**
+    *  @brief
+    *    Watch directory with fanotify
+    *
+    *  @param[in] dir
+    *    Handle to directory that shall be watched
+    *  @param[in] events
+    *    Events that are watched (combination of FileEvent values)
+    *  @param[in] recursive
+    *    Watch file system recursively?
+    *
+    *  @return
+    *    'true' if the directory is watched, 'false' if fanotify cannot be used for it
+    */
+    bool addMark(FileHandle & dir, unsigned int events, RecursiveMode recursive);
+
+    /**
+    *  @brief
+    *    Read and process all pending fanotify events
+    */
+    void readFanotifyEvents();
+
+    /**
+    *  @brief
+    *    Process a single fanotify event
+    *
+    *  @param[in] metadata
+    *    Pointer to event (fanotify_event_metadata)
+    */
+    void processFanotifyEvent(const void * metadata);
+
+    /**
+    *  @brief
+    *    Get path of the file an event refers to
+    *
+    *  @param[in] info
+    *    Pointer to information record (fanotify_event_info_fid) containing directory handle and file name
+    *  @param[out] fsid
+    *    ID of the file system
+    *  @param[out] path
+    *    Absolute path of the file
+    *
+    *  @return
+    *    'true' if the path could be resolved, else 'false'
+    */
+    bool resolvePath(const void * info, std::string & fsid, std::string & path) const;
+
+    /**
+    *  @brief
+    *    Find watched directory that contains a file
+    *
+    *  @param[in] fsid
+    *    ID of the file system
+    *  @param[in] path
+    *    Absolute path of the file
+    *  @param[out] relative
+    *    Path relative to the watched directory
+    *
+    *  @return
+    *    Watched directory, null if the file is not watched
+    */
+    const Mark * findMark(const std::string & fsid, const std::string & path, std::string & relative) const;
+
+
+protected:
+    int               m_fanotify; ///< File handle for the fanotify instance (-1 if not available)
+    int               m_epoll;    ///< File handle for the epoll instance that waits for fanotify and inotify events
+    std::vector<Mark> m_marks;    ///< Directories watched by fanotify
+};
+
+
+} // namespace cppfs
@@ -4,6 +4,7 @@
 
 #include <memory>
 #include <map>
+#include <string>
 
 #include <cppfs/AbstractFileWatcherBackend.h>
 #include <cppfs/FileHandle.h>
@@ -44,6 +45,47 @@ public:
     virtual AbstractFileSystem * fs() const override;
     virtual void add(FileHandle & dir, unsigned int events, RecursiveMode recursive) override;
     virtual void watch(int timeout) override;
+    virtual int nativeHandle() const override;
+    virtual unsigned int supportedEvents() const override;
+    virtual void processPending() override;
+
+
+protected:
+    /**
+    *  @brief
+    *    Read and process pending inotify events
+    *
+    *  @remarks
+    *    Reads until the event queue is empty, never blocks.
+    */
+    void readEvents();
+
+    /**
+    *  @brief
+    *    Update watchers after a directory has been renamed
+    *
+    *  @param[in] from
+    *    Previous path of the directory
+    *  @param[in] to
+    *    New path of the directory
+    *
+    *  @return
+    *    'true' if the directory or one of its subdirectories was watched, else 'false'
+    *
+    *  @remarks
+    *    inotify watches stay attached to the renamed directories,
+    *    so only the paths that are reported for them need to be updated.
+    */
+    bool renameWatchers(const std::string & from, const std::string & to);
+
+    /**
+    *  @brief
+    *    Stop watching a directory and its subdirectories
+    *
+    *  @param[in] path
+    *    Path of the directory
+    */
+    void removeWatchers(const std::string & path);
 
 
 protected:
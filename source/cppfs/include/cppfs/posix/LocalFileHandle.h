@@ -49,6 +49,27 @@ public:
     */
     virtual ~LocalFileHandle();
 
+    /**
+    *  @brief
+    *    Get number of directories that are removed in the background
+    *
+    *  @return
+    *    Number of directories that are queued or being removed
+    */
+    static unsigned int pendingRemovals();
+
+    /**
+    *  @brief
+    *    Wait until all directories have been removed in the background
+    *
+    *  @param[in] timeout
+    *    Timeout in milliseconds (less than zero for infinite)
+    *
+    *  @return
+    *    'true' if no removals are pending, 'false' if the timeout has expired
+    */
+    static bool waitForRemovals(int timeout);
+
     // Virtual AbstractFileHandleBackend functions
     virtual std::unique_ptr<AbstractFileHandleBackend> clone() const override;
     virtual AbstractFileSystem * fs() const override;
@@ -71,7 +92,11 @@ public:
     virtual void setPermissions(unsigned long permissions) override;
     virtual bool createDirectory() override;
     virtual bool removeDirectory() override;
-    virtual bool copy(AbstractFileHandleBackend & dest) override;
+    virtual CopyResult copyDirectoryRec(AbstractFileHandleBackend & dest, const CopyOptions & options) override;
+    virtual bool cloneDirectory(AbstractFileHandleBackend & dest, const CopyOptions & options, unsigned long long & clonedBytes, unsigned long long & copiedBytes) override;
+    virtual bool removeDirectoryRec() override;
+    virtual bool removeDirectoryRecAsync() override;
+    virtual bool copy(AbstractFileHandleBackend & dest, const CopyOptions & options) override;
     virtual bool move(AbstractFileHandleBackend & dest) override;
     virtual bool createLink(AbstractFileHandleBackend & dest) override;
     virtual bool createSymbolicLink(AbstractFileHandleBackend & dest) override;
@@ -79,6 +104,9 @@ public:
     virtual bool remove() override;
     virtual std::unique_ptr<std::istream> createInputStream(std::ios_base::openmode mode) const override;
     virtual std::unique_ptr<std::ostream> createOutputStream(std::ios_base::openmode mode) override;
+    virtual bool writeFileAtomic(const std::string & content, bool sync) override;
+    virtual bool syncFileSystem() override;
+    virtual unsigned long long deviceId() const override;
 
 
 protected:
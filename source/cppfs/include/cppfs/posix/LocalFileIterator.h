@@ -59,6 +59,7 @@ public:
     virtual int index() const override;
     virtual std::string name() const override;
     virtual void next() override;
+    virtual bool entryInfo(EntryInfo & info) const override;
 
 
 protected:
@@ -0,0 +1,192 @@
+
+#pragma once
+
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <cppfs/cppfs.h>
+
+
+namespace cppfs
+{
+
+
+class SshFileSystem;
+class SshSession;
+
+
+/**
+*  @brief
+*    Event loop that runs SFTP operations concurrently on one connection
+*
+*  @remarks
+*    The event loop owns a non-blocking SSH session with several SFTP
+*    channels. Operations are submitted from any thread and return a
+*    future. A background thread runs one operation per channel at a
+*    time: when none of them can continue, it waits on the socket of
+*    the session until the server has answered.
+*
+*    libssh2 keeps the state of a pending request in the SFTP channel,
+*    so a channel can only run one operation at a time. The number of
+*    channels therefore determines how many requests are in flight.
+*/
+class CPPFS_API SshEventLoop
+{
+public:
+    /**
+    *  @brief
+    *    Operation on an SFTP channel
+    *
+    *  @remarks
+    *    The function receives the LIBSSH2_SESSION and LIBSSH2_SFTP
+    *    handles. It is called again as long as it returns
+    *    LIBSSH2_ERROR_EAGAIN, so it has to keep its state between calls.
+    *    Any other value finishes the operation and is passed to its future.
+    */
+    using Operation = std::function<int (void * session, void * sftpSession)>;
+
+
+public:
+    /**
+    *  @brief
+    *    Constructor
+    *
+    *  @param[in] fs
+    *    File system that owns the event loop
+    *  @param[in] session
+    *    SSH session (must NOT be null!)
+    *  @param[in] channels
+    *    Number of SFTP channels
+    */
+    SshEventLoop(SshFileSystem & fs, std::unique_ptr<SshSession> session, unsigned int channels);
+
+    /**
+    *  @brief
+    *    Destructor
+    *
+    *  @remarks
+    *    Waits for running operations to finish. Operations that have
+    *    not been started yet are finished with -1.
+    */
+    ~SshEventLoop();
+
+    /**
+    *  @brief
+    *    Check if the event loop is connected
+    *
+    *  @return
+    *    'true' if at least one SFTP channel could be opened, else 'false'
+    */
+    bool isConnected() const;
+
+    /**
+    *  @brief
+    *    Submit operation
+    *
+    *  @param[in] operation
+    *    Operation
+    *
+    *  @return
+    *    Future that receives the result of the operation
+    */
+    std::future<int> submit(Operation operation);
+
+    /**
+    *  @brief
+    *    Get attributes of a file or directory
+    *
+    *  @param[in] path
+    *    Path to file or directory
+    *
+    *  @return
+    *    Future that receives 'true' if the file exists, else 'false'
+    *
+    *  @remarks
+    *    The attributes are added to the attribute cache of the file
+    *    system, so the next handle opened on the path does not need to
+    *    query them again.
+    */
+    std::future<bool> stat(const std::string & path);
+
+    /**
+    *  @brief
+    *    List directory
+    *
+    *  @param[in] path
+    *    Path to directory
+    *
+    *  @return
+    *    Future that receives the names of the directory entries
+    *
+    *  @remarks
+    *    The attributes of the entries are added to the attribute cache
+    *    of the file system.
+    */
+    std::future<std::vector<std::string>> listFiles(const std::string & path);
+
+    /**
+    *  @brief
+    *    Read file
+    *
+    *  @param[in] path
+    *    Path to file
+    *
+    *  @return
+    *    Future that receives the content of the file (empty on error)
+    */
+    std::future<std::string> readFile(const std::string & path);
+
+
+protected:
+    /**
+    *  @brief
+    *    Submitted operation
+    */
+    struct Task {
+        Operation          operation; ///< Operation
+        std::promise<int>  result;    ///< Receives the result
+    };
+
+
+protected:
+    /**
+    *  @brief
+    *    Run event loop (called on the background thread)
+    */
+    void run();
+
+    /**
+    *  @brief
+    *    Wait until the socket is ready for the directions libssh2 is blocked on
+    *
+    *  @param[in] timeout
+    *    Timeout (in milliseconds)
+    *
+    *  @remarks
+    *    If libssh2 is not blocked in any direction, this waits for at most
+    *    10 milliseconds for incoming data.
+    */
+    void waitSocket(int timeout);
+
+
+protected:
+    SshFileSystem                     & m_fs;        ///< File system that owns the event loop
+    std::unique_ptr<SshSession>         m_session;   ///< Non-blocking SSH session
+    std::vector<void *>                 m_channels;  ///< SFTP channels
+    std::deque<std::unique_ptr<Task>>   m_queue;     ///< Operations that have not been started
+    bool                                m_stop;      ///< Stop the event loop?
+    std::mutex                          m_mutex;     ///< Protects the queue and stop flag
+    std::condition_variable             m_condition; ///< Signals new operations while idle
+    std::thread                         m_thread;    ///< Background thread
+};
+
+
+} // namespace cppfs
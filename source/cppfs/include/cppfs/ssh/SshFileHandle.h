@@ -60,7 +60,9 @@ public:
     virtual void setPermissions(unsigned long permissions) override;
     virtual bool createDirectory() override;
     virtual bool removeDirectory() override;
-    virtual bool copy(AbstractFileHandleBackend & dest) override;
+    virtual CopyResult copyDirectoryRec(AbstractFileHandleBackend & dest, const CopyOptions & options) override;
+    virtual bool removeDirectoryRec() override;
+    virtual bool copy(AbstractFileHandleBackend & dest, const CopyOptions & options) override;
     virtual bool move(AbstractFileHandleBackend & dest) override;
     virtual bool createLink(AbstractFileHandleBackend & dest) override;
     virtual bool createSymbolicLink(AbstractFileHandleBackend & dest) override;
@@ -68,12 +70,22 @@ public:
     virtual bool remove() override;
     virtual std::unique_ptr<std::istream> createInputStream(std::ios_base::openmode mode) const override;
     virtual std::unique_ptr<std::ostream> createOutputStream(std::ios_base::openmode mode) override;
+    virtual bool syncFileSystem() override;
 
 
 protected:
     void readFileInfo() const;
     void readLinkInfo() const;
 
+    /**
+    *  @brief
+    *    Read file information from the attribute cache of the file system
+    *
+    *  @return
+    *    'true' if cached attributes have been found, else 'false'
+    */
+    bool readCachedInfo() const;
+
 
 protected:
     std::shared_ptr<SshFileSystem> m_fs;       ///< File system that created this handle
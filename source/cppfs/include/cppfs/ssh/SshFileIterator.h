@@ -14,6 +14,7 @@ namespace cppfs
 
 
 class SshFileSystem;
+class SshSession;
 
 
 /**
@@ -48,6 +49,7 @@ public:
     virtual int index() const override;
     virtual std::string name() const override;
     virtual void next() override;
+    virtual bool entryInfo(EntryInfo & info) const override;
 
 
 protected:
@@ -57,6 +59,7 @@ protected:
 protected:
     std::shared_ptr<SshFileSystem>   m_fs;       ///< File system that created this iterator
     std::string                      m_path;     ///< Path to file or directory
+    SshSession                     * m_session;  ///< Session on which the directory has been opened
     LIBSSH2_SFTP_HANDLE            * m_dir;      ///< Directory handle
     int                              m_index;    ///< Current entry index
     std::string                      m_filename; ///< Current entry file name
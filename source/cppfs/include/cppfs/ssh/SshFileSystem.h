@@ -4,6 +4,13 @@
 
 #include <memory>
 #include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include <libssh2_sftp.h>
 
 #include <cppfs/AbstractFileSystem.h>
 
@@ -12,9 +19,21 @@ namespace cppfs
 {
 
 
+class LoginCredentials;
+class SshSession;
+class SshEventLoop;
+
+
 /**
 *  @brief
 *    Representation of a remote file system accessed by SSH
+*
+*  @remarks
+*    The file system can open several SSH sessions to the same host.
+*    Each operation and each opened file is bound to one session, which
+*    is locked while it is used. Handles and streams can therefore be
+*    used from multiple threads, and transfers on different sessions
+*    run in parallel.
 */
 class CPPFS_API SshFileSystem : public AbstractFileSystem, public std::enable_shared_from_this<SshFileSystem>
 {
@@ -22,6 +41,20 @@ class CPPFS_API SshFileSystem : public AbstractFileSystem, public std::enable_sh
     friend class SshFileIterator;
     friend class SshInputStreamBuffer;
     friend class SshOutputStreamBuffer;
+    friend class SshEventLoop;
+
+
+public:
+    /**
+    *  @brief
+    *    Durability policy for written files
+    */
+    enum SyncMode
+    {
+        SyncPerFile = 0, ///< Flush each file to disk when it is closed (fsync)
+        SyncPerBatch,    ///< Do not flush files, call sync() after a batch of files has been written
+        SyncNever        ///< Never flush files, leave it to the remote host
+    };
 
 
 public:
@@ -41,6 +74,33 @@ public:
     *    Path to public key file
     *  @param[in] privateKey
     *    Path to private key file
+    *  @param[in] options
+    *    Connection options (can be null, see remarks)
+    *
+    *  @remarks
+    *    The following options are read from the given credentials:
+    *      - readAhead: Number of SFTP read requests that are kept in
+    *        flight while reading a file (default: 16)
+    *      - writeAhead: Number of SFTP write requests that are kept in
+    *        flight while writing a file (default: 16)
+    *      - sync: When written files are flushed to disk on the remote
+    *        host: "file" (default), "batch" or "never" (see SyncMode)
+    *      - sessions: Maximum number of SSH sessions that are opened
+    *        to the host (default: 1). Additional sessions are opened
+    *        when all sessions are used by other threads.
+    *      - attributeCacheTime: Time for which file attributes received
+    *        while listing a directory are used by handles to its entries
+    *        (in milliseconds, default: 2000, 0 to disable)
+    *      - asyncChannels: Number of SFTP channels of the event loop,
+    *        which is the number of asynchronous operations that are in
+    *        flight at the same time (default: 8)
+    *      - ciphers, macs, kex, hostKeys: Preferred transport methods as
+    *        comma-separated lists (e.g., "aes128-gcm@openssh.com,chacha20-poly1305@openssh.com",
+    *        default: libssh2 defaults)
+    *      - compression: Enable zlib compression, which helps with
+    *        compressible data on slow links (default: "false")
+    *      - windowSize: Receive window of SSH channels in bytes, larger
+    *        windows help on links with high latency (default: libssh2 default)
     */
     SshFileSystem(
         const std::string & host,
@@ -48,7 +108,8 @@ public:
         const std::string & username,
         const std::string & password,
         const std::string & publicKey,
-        const std::string & privateKey
+        const std::string & privateKey,
+        const LoginCredentials * options = nullptr
     );
 
     /**
@@ -67,6 +128,33 @@ public:
     *    Path to public key file
     *  @param[in] privateKey
     *    Path to private key file
+    *  @param[in] options
+    *    Connection options (can be null, see remarks)
+    *
+    *  @remarks
+    *    The following options are read from the given credentials:
+    *      - readAhead: Number of SFTP read requests that are kept in
+    *        flight while reading a file (default: 16)
+    *      - writeAhead: Number of SFTP write requests that are kept in
+    *        flight while writing a file (default: 16)
+    *      - sync: When written files are flushed to disk on the remote
+    *        host: "file" (default), "batch" or "never" (see SyncMode)
+    *      - sessions: Maximum number of SSH sessions that are opened
+    *        to the host (default: 1). Additional sessions are opened
+    *        when all sessions are used by other threads.
+    *      - attributeCacheTime: Time for which file attributes received
+    *        while listing a directory are used by handles to its entries
+    *        (in milliseconds, default: 2000, 0 to disable)
+    *      - asyncChannels: Number of SFTP channels of the event loop,
+    *        which is the number of asynchronous operations that are in
+    *        flight at the same time (default: 8)
+    *      - ciphers, macs, kex, hostKeys: Preferred transport methods as
+    *        comma-separated lists (e.g., "aes128-gcm@openssh.com,chacha20-poly1305@openssh.com",
+    *        default: libssh2 defaults)
+    *      - compression: Enable zlib compression, which helps with
+    *        compressible data on slow links (default: "false")
+    *      - windowSize: Receive window of SSH channels in bytes, larger
+    *        windows help on links with high latency (default: libssh2 default)
     */
     SshFileSystem(
         std::string && host,
@@ -74,7 +162,8 @@ public:
         std::string && username,
         std::string && password,
         std::string && publicKey,
-        std::string && privateKey
+        std::string && privateKey,
+        const LoginCredentials * options = nullptr
     );
 
     /**
@@ -86,14 +175,251 @@ public:
     // Virtual AbstractFileSystem functions
     virtual FileHandle open(const std::string & path) override;
     virtual FileHandle open(std::string && path) override;
-    virtual std::unique_ptr<AbstractFileWatcherBackend> createFileWatcher(FileWatcher & fileWatcher) override;
+    virtual std::unique_ptr<AbstractFileWatcherBackend> createFileWatcher(FileWatcher & fileWatcher, WatcherType type) override;
+    virtual std::vector<std::string> sha1(const std::vector<std::string> & paths) override;
+    virtual std::unique_ptr<Tree> readTree(const std::string & path, const std::string & treePath) override;
+
+    /**
+    *  @brief
+    *    Get durability policy for written files
+    *
+    *  @return
+    *    Sync mode
+    */
+    SyncMode syncMode() const;
+
+    /**
+    *  @brief
+    *    Set durability policy for written files
+    *
+    *  @param[in] mode
+    *    Sync mode
+    *
+    *  @remarks
+    *    Applies to files that are opened for writing afterwards.
+    */
+    void setSyncMode(SyncMode mode);
+
+    /**
+    *  @brief
+    *    Flush all written data to disk on the remote host
+    *
+    *  @return
+    *    'true' if successful, else 'false'
+    *
+    *  @remarks
+    *    Runs 'sync' on the remote host, which requires shell access.
+    *    Use this with SyncPerBatch after a batch of files has been
+    *    written, so that only one flush is needed for all of them.
+    */
+    bool sync();
+
+    /**
+    *  @brief
+    *    Execute command on the remote host
+    *
+    *  @param[in] command
+    *    Command line
+    *  @param[out] output
+    *    Receives the standard output of the command (can be null)
+    *
+    *  @return
+    *    Exit status of the command, -1 if it could not be executed
+    *
+    *  @remarks
+    *    Blocks until the command has finished. Its standard error
+    *    output is discarded. If a command cannot be executed (e.g., the
+    *    server only allows SFTP), no further commands are attempted and
+    *    -1 is returned right away.
+    */
+    int execute(const std::string & command, std::string * output = nullptr);
+
+    /**
+    *  @brief
+    *    Execute command with many arguments on the remote host
+    *
+    *  @param[in] command
+    *    Command line without the arguments
+    *  @param[in] args
+    *    Arguments (quoted by this function)
+    *  @param[out] output
+    *    Receives the standard output of all commands (can be null)
+    *
+    *  @return
+    *    Highest exit status of the commands, -1 or 127 if they could not be executed
+    *
+    *  @remarks
+    *    The arguments are split into as few commands as possible
+    *    without exceeding the maximum length of a command line.
+    */
+    int execute(const std::string & command, const std::vector<std::string> & args, std::string * output = nullptr);
+
+    /**
+    *  @brief
+    *    Remove files and directory trees on the remote host
+    *
+    *  @param[in] paths
+    *    Paths to files or directories
+    *
+    *  @return
+    *    'true' if all paths have been removed, else 'false'
+    *
+    *  @remarks
+    *    Runs 'rm -rf' on the remote host, so that all paths are
+    *    removed with a few commands. Symbolic links are not followed.
+    */
+    bool removeAll(const std::vector<std::string> & paths);
+
+    /**
+    *  @brief
+    *    Check if the connection is alive
+    *
+    *  @return
+    *    'true' if the server answers requests, else 'false'
+    *
+    *  @remarks
+    *    Sends a request to the server and waits for the answer. The
+    *    session is taken with acquireSession(), so the check does not
+    *    wait for transfers on other sessions if one of them is idle.
+    */
+    bool isConnected();
+
+    /**
+    *  @brief
+    *    Get event loop for asynchronous operations
+    *
+    *  @return
+    *    Event loop
+    *
+    *  @remarks
+    *    The event loop uses its own non-blocking session, which is
+    *    opened on the first call.
+    */
+    SshEventLoop & eventLoop();
+
+    /**
+    *  @brief
+    *    Get number of sessions
+    *
+    *  @return
+    *    Number of SSH sessions that are currently opened to the host
+    */
+    size_t sessionCount() const;
 
 
 protected:
-    void connect();
-    void disconnect();
-    void initSftp();
-    void checkError();
+    /**
+    *  @brief
+    *    Quote argument for the remote shell
+    *
+    *  @param[in] arg
+    *    Argument
+    *
+    *  @return
+    *    Argument in single quotes, which can be passed to the shell as is
+    */
+    static std::string quote(const std::string & arg);
+
+    /**
+    *  @brief
+    *    Apply connection options
+    *
+    *  @param[in] options
+    *    Connection options (can be null)
+    */
+    void applyOptions(const LoginCredentials * options);
+
+    /**
+    *  @brief
+    *    Open a new session to the host
+    *
+    *  @return
+    *    Session (never null, but it may not be connected)
+    */
+    std::unique_ptr<SshSession> createSession() const;
+
+    /**
+    *  @brief
+    *    Get size of the read buffer for file streams
+    *
+    *  @return
+    *    Buffer size (in bytes)
+    *
+    *  @remarks
+    *    libssh2 splits each read into SFTP requests of a fixed size and
+    *    sends them at once, so the buffer size determines how many
+    *    read requests are in flight.
+    */
+    size_t readBufferSize() const;
+
+    /**
+    *  @brief
+    *    Get size of the write buffer for file streams
+    *
+    *  @return
+    *    Buffer size (in bytes)
+    *
+    *  @remarks
+    *    libssh2 splits each write into SFTP requests of a fixed size and
+    *    sends them at once, so the buffer size determines how many
+    *    write requests are in flight.
+    */
+    size_t writeBufferSize() const;
+
+    /**
+    *  @brief
+    *    Get a session for an operation
+    *
+    *  @param[out] lock
+    *    Receives the lock on the session, which must be held while it is used
+    *
+    *  @return
+    *    Session
+    *
+    *  @remarks
+    *    Prefers sessions that are not used by another thread. If all
+    *    sessions are busy, waits for the next one in turn.
+    */
+    SshSession & acquireSession(std::unique_lock<std::recursive_mutex> & lock);
+
+    /**
+    *  @brief
+    *    Remember attributes of a directory entry
+    *
+    *  @param[in] path
+    *    Path to file or directory
+    *  @param[in] attrs
+    *    Attributes as received by readdir (links are not resolved)
+    *
+    *  @remarks
+    *    Directory listings contain the attributes of all entries, so
+    *    they are kept for the next handle that is opened on the entry,
+    *    which saves a stat request to the server.
+    */
+    void cacheAttributes(const std::string & path, const LIBSSH2_SFTP_ATTRIBUTES & attrs);
+
+    /**
+    *  @brief
+    *    Get and remove cached attributes of a file
+    *
+    *  @param[in] path
+    *    Path to file or directory
+    *  @param[out] attrs
+    *    Receives the attributes (links are not resolved)
+    *
+    *  @return
+    *    'true' if attributes have been found and are not outdated, else 'false'
+    */
+    bool takeCachedAttributes(const std::string & path, LIBSSH2_SFTP_ATTRIBUTES & attrs);
+
+    /**
+    *  @brief
+    *    Remove cached attributes of a file and everything below it
+    *
+    *  @param[in] path
+    *    Path to file or directory
+    */
+    void invalidateAttributes(const std::string & path);
 
 
 protected:
@@ -105,10 +431,38 @@ protected:
     std::string m_publicKey;
     std::string m_privateKey;
 
+    // Options
+    unsigned int m_readAhead;   ///< Number of SFTP read requests in flight
+    unsigned int m_writeAhead;  ///< Number of SFTP write requests in flight
+    SyncMode     m_syncMode;    ///< Durability policy for written files
+    unsigned int m_maxSessions; ///< Maximum number of sessions
+    unsigned int m_cacheTime;   ///< Time for which cached attributes are valid (in milliseconds)
+    unsigned int m_channels;    ///< Number of SFTP channels of the event loop
+    std::string  m_ciphers;     ///< Preferred ciphers
+    std::string  m_macs;        ///< Preferred message authentication codes
+    std::string  m_kex;         ///< Preferred key exchange methods
+    std::string  m_hostKeys;    ///< Preferred host key types
+    bool         m_compression; ///< Enable zlib compression?
+    unsigned int m_windowSize;  ///< Receive window of channels (in bytes, 0 for default)
+
+    // Remote commands
+    std::atomic<bool> m_remoteExec; ///< Can commands be executed on the remote host?
+    std::atomic<bool> m_remoteHash; ///< Can hashes be computed on the remote host?
+    std::atomic<bool> m_remoteFind; ///< Can trees be listed on the remote host?
+
     // Connection
-    int    m_socket;      ///< Socket to host
-    void * m_session;     ///< SSH session handle
-    void * m_sftpSession; ///< SFTP session handle
+    std::vector<std::unique_ptr<SshSession>> m_sessions;      ///< Sessions to host
+    unsigned int                             m_nextSession;   ///< Index of the next session to use
+    unsigned int                             m_connecting;    ///< Number of sessions that are being opened
+    mutable std::mutex                       m_sessionsMutex; ///< Protects the list of sessions
+
+    // Attribute cache
+    std::map<std::string, std::pair<std::chrono::steady_clock::time_point, LIBSSH2_SFTP_ATTRIBUTES>> m_attrCache;      ///< Attributes from directory listings (path -> time and attributes)
+    std::mutex                                                                                        m_attrCacheMutex; ///< Protects the attribute cache
+
+    // Asynchronous operations
+    std::unique_ptr<SshEventLoop> m_eventLoop;      ///< Event loop (created on demand)
+    std::mutex                    m_eventLoopMutex; ///< Protects the creation of the event loop
 };
 
 
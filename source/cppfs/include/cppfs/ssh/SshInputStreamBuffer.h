@@ -16,6 +16,7 @@ namespace cppfs
 
 
 class SshFileSystem;
+class SshSession;
 
 
 /**
@@ -39,8 +40,13 @@ public:
     *    Size of the read buffer
     *  @param[n] putbackSize
     *    Size of the putback area
+    *
+    *  @remarks
+    *    libssh2 requests the whole buffer at once, split into several
+    *    SFTP read requests that are in flight at the same time. Larger
+    *    buffers therefore increase the throughput on high-latency links.
     */
-    SshInputStreamBuffer(std::shared_ptr<SshFileSystem> fs, const std::string & path, std::ios_base::openmode mode, size_t bufferSize = size_kb(32), size_t putBackSize = size_b(128));
+    SshInputStreamBuffer(std::shared_ptr<SshFileSystem> fs, const std::string & path, std::ios_base::openmode mode, size_t bufferSize = size_kb(480), size_t putBackSize = size_b(128));
 
     /**
     *  @brief
@@ -57,6 +63,7 @@ public:
 protected:
     std::shared_ptr<SshFileSystem>   m_fs;          ///< File system that created this iterator
     const std::string                m_path;        ///< Path to file or directory
+    SshSession                     * m_session;     ///< Session on which the file has been opened
     void                           * m_file;        ///< SFTP file handle
     const size_t                     m_putbackSize; ///< Size of the putback area
     std::vector<char>                m_buffer;      ///< Read buffer
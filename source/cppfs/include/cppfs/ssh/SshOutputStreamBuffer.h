@@ -16,6 +16,7 @@ namespace cppfs
 
 
 class SshFileSystem;
+class SshSession;
 
 
 /**
@@ -39,13 +40,15 @@ public:
     *    Size of the internal buffer
     *
     *  @remarks
-    *    Do not set bufferSize to higher values, as libssh2 does not seem to
-    *    support it. Testing revealed any values heigher than 24k to fail
-    *    (files ended up not being written entirely).
+    *    libssh2 sends the whole buffer at once, split into several SFTP
+    *    write requests that are in flight at the same time, but it may
+    *    return before all of them have been acknowledged. The rest of the
+    *    buffer is then written by further calls, so large buffers are
+    *    safe and increase the throughput on high-latency links.
     *
     *    See https://c-ares.haxx.se/mail/libssh2-devel-archive-2010-02/0170.shtml
     */
-    SshOutputStreamBuffer(std::shared_ptr<SshFileSystem> fs, const std::string & path, std::ios_base::openmode mode, size_t bufferSize = size_kb(24));
+    SshOutputStreamBuffer(std::shared_ptr<SshFileSystem> fs, const std::string & path, std::ios_base::openmode mode, size_t bufferSize = size_kb(480));
 
     /**
     *  @brief
@@ -61,10 +64,12 @@ public:
 
 
 protected:
-    std::shared_ptr<SshFileSystem>         m_fs;     ///< File system that created this iterator
-    const std::string                      m_path;   ///< Path to file or directory
-    void                                 * m_file;   ///< SFTP file handle
-    std::vector<std::streambuf::char_type> m_buffer; ///< Write buffer
+    std::shared_ptr<SshFileSystem>         m_fs;      ///< File system that created this iterator
+    const std::string                      m_path;    ///< Path to file or directory
+    SshSession                           * m_session; ///< Session on which the file has been opened
+    void                                 * m_file;    ///< SFTP file handle
+    bool                                   m_sync;    ///< Sync file to disk when it is closed (sync mode at the time the file has been opened)
+    std::vector<std::streambuf::char_type> m_buffer;  ///< Write buffer
 };
 
 
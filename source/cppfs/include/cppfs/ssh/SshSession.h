@@ -0,0 +1,231 @@
+
+#pragma once
+
+
+#include <string>
+#include <mutex>
+#include <functional>
+
+#include <cppfs/cppfs.h>
+
+
+namespace cppfs
+{
+
+
+/**
+*  @brief
+*    Connection to an SSH server
+*
+*  @remarks
+*    A session consists of an SSH connection and an SFTP channel over
+*    that connection. libssh2 handles must not be used by multiple
+*    threads at once, so the session must be locked by its mutex while
+*    it is used.
+*/
+class CPPFS_API SshSession
+{
+public:
+    /**
+    *  @brief
+    *    Transport settings
+    *
+    *  @remarks
+    *    Method preferences are comma-separated lists of algorithm names
+    *    in the order of preference (e.g., "aes128-gcm@openssh.com,aes128-ctr").
+    *    Empty lists keep the defaults of libssh2.
+    */
+    struct Settings
+    {
+        Settings() : compression(false), windowSize(0) { }
+
+        std::string  ciphers;     ///< Preferred ciphers
+        std::string  macs;        ///< Preferred message authentication codes
+        std::string  kex;         ///< Preferred key exchange methods
+        std::string  hostKeys;    ///< Preferred host key types
+        bool         compression; ///< Enable zlib compression?
+        unsigned int windowSize;  ///< Receive window of channels (in bytes, 0 for the default of libssh2)
+    };
+
+
+public:
+    /**
+    *  @brief
+    *    Constructor
+    *
+    *  @param[in] host
+    *    Host name
+    *  @param[in] port
+    *    Port
+    *  @param[in] username
+    *    User name
+    *  @param[in] password
+    *    Password
+    *  @param[in] publicKey
+    *    Path to public key file
+    *  @param[in] privateKey
+    *    Path to private key file
+    *  @param[in] settings
+    *    Transport settings
+    *
+    *  @remarks
+    *    Connects to the server immediately.
+    */
+    SshSession(
+        const std::string & host,
+        int port,
+        const std::string & username,
+        const std::string & password,
+        const std::string & publicKey,
+        const std::string & privateKey,
+        const Settings & settings = Settings()
+    );
+
+    /**
+    *  @brief
+    *    Destructor
+    */
+    ~SshSession();
+
+    /**
+    *  @brief
+    *    Get mutex that protects the session
+    *
+    *  @return
+    *    Mutex
+    */
+    std::recursive_mutex & mutex();
+
+    /**
+    *  @brief
+    *    Get socket
+    *
+    *  @return
+    *    Socket to host (-1 if not connected)
+    */
+    int socket() const;
+
+    /**
+    *  @brief
+    *    Set blocking mode
+    *
+    *  @param[in] blocking
+    *    'true' if calls on the session block until they are finished, 'false'
+    *    if they return LIBSSH2_ERROR_EAGAIN instead of waiting (default: 'true')
+    */
+    void setBlocking(bool blocking);
+
+    /**
+    *  @brief
+    *    Get SSH session handle
+    *
+    *  @return
+    *    LIBSSH2_SESSION handle (null if not connected)
+    */
+    void * session() const;
+
+    /**
+    *  @brief
+    *    Get SFTP session handle
+    *
+    *  @return
+    *    LIBSSH2_SFTP handle (null if not connected)
+    *
+    *  @remarks
+    *    The SFTP channel is opened on the first call.
+    */
+    void * sftpSession();
+
+    /**
+    *  @brief
+    *    Open additional SFTP channel
+    *
+    *  @return
+    *    LIBSSH2_SFTP handle (null on error), must be closed with libssh2_sftp_shutdown
+    *
+    *  @remarks
+    *    The receive window of the channel is enlarged to the configured size.
+    */
+    void * openSftpChannel();
+
+    /**
+    *  @brief
+    *    Check if the connection is alive
+    *
+    *  @return
+    *    'true' if the server answers requests, else 'false'
+    *
+    *  @remarks
+    *    Sends a request to the server and waits for the answer.
+    */
+    bool isConnected();
+
+    /**
+    *  @brief
+    *    Execute command on the remote host
+    *
+    *  @param[in] command
+    *    Command line
+    *  @param[out] output
+    *    Receives the standard output of the command (can be null)
+    *
+    *  @return
+    *    Exit status of the command, -1 if it could not be executed
+    */
+    int execute(const std::string & command, std::string * output = nullptr);
+
+    /**
+    *  @brief
+    *    Execute command on the remote host
+    *
+    *  @param[in] command
+    *    Command line
+    *  @param[in] output
+    *    Function that is called with each chunk of the standard output of the command
+    *
+    *  @return
+    *    Exit status of the command, -1 if it could not be executed
+    */
+    int execute(const std::string & command, const std::function<void (const char * data, size_t size)> & output);
+
+    /**
+    *  @brief
+    *    Connect to server
+    *
+    *  @remarks
+    *    Closes the current connection first.
+    */
+    void connect();
+
+    /**
+    *  @brief
+    *    Close connection
+    */
+    void disconnect();
+
+    /**
+    *  @brief
+    *    Recover from an error by reconnecting
+    */
+    void checkError();
+
+
+protected:
+    // Configuration
+    std::string m_host;
+    int         m_port;
+    std::string m_username;
+    std::string m_password;
+    std::string m_publicKey;
+    std::string m_privateKey;
+    Settings    m_settings;
+
+    // Connection
+    int                  m_socket;      ///< Socket to host
+    void               * m_session;     ///< SSH session handle
+    void               * m_sftpSession; ///< SFTP session handle
+    std::recursive_mutex m_mutex;       ///< Protects the session
+};
+
+
+} // namespace cppfs
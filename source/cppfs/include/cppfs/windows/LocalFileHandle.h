@@ -60,7 +60,7 @@ public:
     virtual void setPermissions(unsigned long permissions) override;
     virtual bool createDirectory() override;
     virtual bool removeDirectory() override;
-    virtual bool copy(AbstractFileHandleBackend & dest) override;
+    virtual bool copy(AbstractFileHandleBackend & dest, const CopyOptions & options) override;
     virtual bool move(AbstractFileHandleBackend & dest) override;
     virtual bool createLink(AbstractFileHandleBackend & dest) override;
     virtual bool createSymbolicLink(AbstractFileHandleBackend & dest) override;
@@ -48,6 +48,7 @@ public:
     virtual AbstractFileSystem * fs() const override;
     virtual void add(FileHandle & dir, unsigned int events, RecursiveMode recursive) override;
     virtual void watch(int timeout) override;
+    virtual unsigned int supportedEvents() const override;
 
 
 protected:
@@ -14,5 +14,40 @@ AbstractFileHandleBackend::~AbstractFileHandleBackend()
 {
 }
 
+AbstractFileHandleBackend::CopyResult AbstractFileHandleBackend::copyDirectoryRec(AbstractFileHandleBackend &, const CopyOptions &)
+{
+    return CopyNotSupported;
+}
+
+bool AbstractFileHandleBackend::cloneDirectory(AbstractFileHandleBackend &, const CopyOptions &, unsigned long long &, unsigned long long &)
+{
+    return false;
+}
+
+bool AbstractFileHandleBackend::removeDirectoryRec()
+{
+    return false;
+}
+
+bool AbstractFileHandleBackend::removeDirectoryRecAsync()
+{
+    return false;
+}
+
+bool AbstractFileHandleBackend::writeFileAtomic(const std::string &, bool)
+{
+    return false;
+}
+
+bool AbstractFileHandleBackend::syncFileSystem()
+{
+    return false;
+}
+
+unsigned long long AbstractFileHandleBackend::deviceId() const
+{
+    return 0;
+}
+
 
 } // namespace cppfs
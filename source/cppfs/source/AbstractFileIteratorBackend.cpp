@@ -14,5 +14,10 @@ AbstractFileIteratorBackend::~AbstractFileIteratorBackend()
 {
 }
 
+bool AbstractFileIteratorBackend::entryInfo(EntryInfo &) const
+{
+    return false;
+}
+
 
 } // namespace cppfs
@@ -2,6 +2,7 @@
 #include <cppfs/AbstractFileSystem.h>
 
 #include <cppfs/FileWatcher.h>
+#include <cppfs/Tree.h>
 
 
 namespace cppfs
@@ -16,5 +17,15 @@ AbstractFileSystem::~AbstractFileSystem()
 {
 }
 
+std::vector<std::string> AbstractFileSystem::sha1(const std::vector<std::string> & paths)
+{
+    return std::vector<std::string>(paths.size());
+}
+
+std::unique_ptr<Tree> AbstractFileSystem::readTree(const std::string &, const std::string &)
+{
+    return nullptr;
+}
+
 
 } // namespace cppfs
@@ -1,7 +1,9 @@
 
 #include <cppfs/AbstractFileWatcherBackend.h>
 
+#include <cppfs/FileHandle.h>
 #include <cppfs/FileWatcher.h>
+#include <cppfs/FileEventInfo.h>
 
 
 namespace cppfs
@@ -17,9 +19,39 @@ AbstractFileWatcherBackend::~AbstractFileWatcherBackend()
 {
 }
 
+int AbstractFileWatcherBackend::nativeHandle() const
+{
+    return -1;
+}
+
+unsigned int AbstractFileWatcherBackend::supportedEvents() const
+{
+    return FileCreated | FileRemoved | FileModified | FileAttrChanged;
+}
+
+void AbstractFileWatcherBackend::processPending()
+{
+    watch(0);
+}
+
+void AbstractFileWatcherBackend::onFileEvent(std::string path, FileEvent event, bool isDirectory, unsigned int cookie, unsigned int mask)
+{
+    m_fileWatcher->queueEvent(FileEventInfo(fs(), event, std::move(path), isDirectory, cookie, "", mask));
+}
+
 void AbstractFileWatcherBackend::onFileEvent(FileHandle & fh, FileEvent event)
 {
-    m_fileWatcher->onFileEvent(fh, event);
+    onFileEvent(fh.path(), event);
+}
+
+void AbstractFileWatcherBackend::onFileMoved(std::string from, std::string to, bool isDirectory, unsigned int cookie, unsigned int mask)
+{
+    m_fileWatcher->queueEvent(FileEventInfo(fs(), FileMoved, std::move(to), isDirectory, cookie, std::move(from), mask));
+}
+
+void AbstractFileWatcherBackend::onFileMoved(FileHandle & from, FileHandle & to)
+{
+    onFileMoved(from.path(), to.path());
 }
 
 
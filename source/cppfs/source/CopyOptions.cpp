@@ -0,0 +1,68 @@
+
+#include <cppfs/CopyOptions.h>
+
+#include <algorithm>
+
+
+namespace cppfs
+{
+
+
+CopyOptions::CopyOptions()
+: m_workers(1)
+, m_chunkSize(16 * 1024 * 1024)
+, m_preserveMetadata(false)
+, m_preserveLinks(false)
+{
+}
+
+CopyOptions::~CopyOptions()
+{
+}
+
+unsigned int CopyOptions::workers() const
+{
+    return m_workers;
+}
+
+CopyOptions & CopyOptions::setWorkers(unsigned int workers)
+{
+    m_workers = std::max(workers, 1u);
+    return *this;
+}
+
+size_t CopyOptions::chunkSize() const
+{
+    return m_chunkSize;
+}
+
+CopyOptions & CopyOptions::setChunkSize(size_t chunkSize)
+{
+    m_chunkSize = std::max(chunkSize, static_cast<size_t>(64 * 1024));
+    return *this;
+}
+
+bool CopyOptions::preserveMetadata() const
+{
+    return m_preserveMetadata;
+}
+
+CopyOptions & CopyOptions::setPreserveMetadata(bool preserve)
+{
+    m_preserveMetadata = preserve;
+    return *this;
+}
+
+bool CopyOptions::preserveLinks() const
+{
+    return m_preserveLinks;
+}
+
+CopyOptions & CopyOptions::setPreserveLinks(bool preserve)
+{
+    m_preserveLinks = preserve;
+    return *this;
+}
+
+
+} // namespace cppfs
@@ -2,6 +2,7 @@
 #include <cppfs/FileEventHandler.h>
 
 #include <cppfs/FileHandle.h>
+#include <cppfs/FileEventInfo.h>
 
 
 namespace cppfs
@@ -16,6 +17,20 @@ FileEventHandler::~FileEventHandler()
 {
 }
 
+void FileEventHandler::onFileEvents(const std::vector<FileEventInfo> & events)
+{
+    for (auto & event : events) {
+        FileHandle fh = event.fileHandle();
+
+        if (event.event() == FileMoved && !event.fromPath().empty()) {
+            FileHandle from = event.fromFileHandle();
+            onFileMoved(from, fh);
+        } else {
+            onFileEvent(fh, event.event());
+        }
+    }
+}
+
 void FileEventHandler::onFileEvent(FileHandle & fh, FileEvent event)
 {
     switch (event) {
@@ -35,6 +50,10 @@ void FileEventHandler::onFileEvent(FileHandle & fh, FileEvent event)
             onFileAttrChanged(fh);
             break;
 
+        case FileClosedWrite:
+            onFileClosedWrite(fh);
+            break;
+
         default:
             break;
     }
@@ -56,5 +75,14 @@ void FileEventHandler::onFileAttrChanged(FileHandle &)
 {
 }
 
+void FileEventHandler::onFileClosedWrite(FileHandle &)
+{
+}
+
+void FileEventHandler::onFileMoved(FileHandle &, FileHandle & to)
+{
+    onFileEvent(to, FileMoved);
+}
+
 
 } // namespace cppfs
@@ -0,0 +1,140 @@
+
+#include <cppfs/FileEventInfo.h>
+
+#include <cppfs/FileHandle.h>
+#include <cppfs/AbstractFileSystem.h>
+
+
+namespace cppfs
+{
+
+
+FileEventInfo::FileEventInfo()
+: m_fs(nullptr)
+, m_event((FileEvent)0)
+, m_isDirectory(false)
+, m_cookie(0)
+, m_mask(0)
+{
+}
+
+FileEventInfo::FileEventInfo(AbstractFileSystem * fs, FileEvent event, std::string path, bool isDirectory, unsigned int cookie, std::string fromPath, unsigned int mask)
+: m_fs(fs)
+, m_event(event)
+, m_path(std::move(path))
+, m_fromPath(std::move(fromPath))
+, m_isDirectory(isDirectory)
+, m_cookie(cookie)
+, m_mask(mask)
+, m_timestamp(std::chrono::steady_clock::now())
+{
+}
+
+FileEventInfo::FileEventInfo(const FileEventInfo & event)
+: m_fs(event.m_fs)
+, m_event(event.m_event)
+, m_path(event.m_path)
+, m_fromPath(event.m_fromPath)
+, m_isDirectory(event.m_isDirectory)
+, m_cookie(event.m_cookie)
+, m_mask(event.m_mask)
+, m_timestamp(event.m_timestamp)
+{
+}
+
+FileEventInfo::FileEventInfo(FileEventInfo && event)
+: m_fs(event.m_fs)
+, m_event(event.m_event)
+, m_path(std::move(event.m_path))
+, m_fromPath(std::move(event.m_fromPath))
+, m_isDirectory(event.m_isDirectory)
+, m_cookie(event.m_cookie)
+, m_mask(event.m_mask)
+, m_timestamp(event.m_timestamp)
+{
+}
+
+FileEventInfo::~FileEventInfo()
+{
+}
+
+FileEventInfo & FileEventInfo::operator=(const FileEventInfo & event)
+{
+    m_fs          = event.m_fs;
+    m_event       = event.m_event;
+    m_path        = event.m_path;
+    m_fromPath    = event.m_fromPath;
+    m_isDirectory = event.m_isDirectory;
+    m_cookie      = event.m_cookie;
+    m_mask        = event.m_mask;
+    m_timestamp   = event.m_timestamp;
+
+    return *this;
+}
+
+FileEventInfo & FileEventInfo::operator=(FileEventInfo && event)
+{
+    m_fs          = event.m_fs;
+    m_event       = event.m_event;
+    m_path        = std::move(event.m_path);
+    m_fromPath    = std::move(event.m_fromPath);
+    m_isDirectory = event.m_isDirectory;
+    m_cookie      = event.m_cookie;
+    m_mask        = event.m_mask;
+    m_timestamp   = event.m_timestamp;
+
+    return *this;
+}
+
+AbstractFileSystem * FileEventInfo::fs() const
+{
+    return m_fs;
+}
+
+FileEvent FileEventInfo::event() const
+{
+    return m_event;
+}
+
+const std::string & FileEventInfo::path() const
+{
+    return m_path;
+}
+
+const std::string & FileEventInfo::fromPath() const
+{
+    return m_fromPath;
+}
+
+bool FileEventInfo::isDirectory() const
+{
+    return m_isDirectory;
+}
+
+unsigned int FileEventInfo::cookie() const
+{
+    return m_cookie;
+}
+
+unsigned int FileEventInfo::mask() const
+{
+    return m_mask;
+}
+
+std::chrono::steady_clock::time_point FileEventInfo::timestamp() const
+{
+    return m_timestamp;
+}
+
+FileHandle FileEventInfo::fileHandle() const
+{
+    return m_fs ? m_fs->open(m_path) : FileHandle();
+}
+
+FileHandle FileEventInfo::fromFileHandle() const
+{
+    return (m_fs && !m_fromPath.empty()) ? m_fs->open(m_fromPath) : FileHandle();
+}
+
+
+} // namespace cppfs
@@ -5,6 +5,16 @@
 #include <sstream>
 #include <iterator>
 #include <array>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 
 #if defined(__APPLE__)
     #define COMMON_DIGEST_FOR_OPENSSL
@@ -18,6 +28,7 @@
 
 #include <cppfs/fs.h>
 #include <cppfs/FilePath.h>
+#include <cppfs/FileWriteBatch.h>
 #include <cppfs/FileIterator.h>
 #include <cppfs/FileVisitor.h>
 #include <cppfs/FunctionalFileVisitor.h>
@@ -28,6 +39,370 @@
 #include <cppfs/AbstractFileIteratorBackend.h>
 
 
+namespace
+{
+
+
+// Suffix of the file that records the progress of a copy
+const char * const progressSuffix = ".cppfs-progress";
+
+// Size of the buffers used to copy files between file systems
+const size_t copyBufferSize = 1024 * 1024;
+
+// Number of buffers that are shared by the reader and writer of a copy
+const size_t copyBufferCount = 4;
+
+// Size of the blocks that are skipped in the destination if they only contain zeros
+const size_t sparseBlockSize = 64 * 1024;
+
+// Number of bytes after which the progress of a copy is recorded
+const unsigned long long progressInterval = 64ull * 1024 * 1024;
+
+// Number of bytes before the recorded offset that are compared before a copy is continued
+const size_t verifySize = 1024 * 1024;
+
+// Suffix of the hidden copy that receives the data of a move until it is complete
+const char * const movingSuffix = ".cppfs-moving";
+
+// Read up to size bytes at the given offset
+size_t readAt(std::istream & stream, unsigned long long offset, char * data, size_t size)
+{
+    stream.clear();
+    stream.seekg(offset);
+    if (!stream) return 0;
+
+    stream.read(data, size);
+    return static_cast<size_t>(stream.gcount());
+}
+
+// Ring of buffers that are filled by a reader thread and written by another thread
+struct BufferRing
+{
+    BufferRing()
+    : buffers(copyBufferCount, std::vector<char>(copyBufferSize))
+    , sizes(copyBufferCount, 0)
+    , first(0)
+    , filled(0)
+    , finished(false)
+    , cancelled(false)
+    {
+    }
+
+    std::vector<std::vector<char>> buffers;   ///< Buffers
+    std::vector<size_t>            sizes;     ///< Number of bytes in each buffer
+    size_t                         first;     ///< Index of the next buffer to write
+    size_t                         filled;    ///< Number of filled buffers
+    bool                           finished;  ///< Has the reader reached the end of the stream?
+    bool                           cancelled; ///< Has the writer stopped?
+    std::mutex                     mutex;     ///< Protects the state of the ring
+    std::condition_variable        condition; ///< Signals changes of the state
+};
+
+// Copy data from a stream while it is written by the given function (returns 'true' if all data has been read and written)
+bool pipelineCopy(std::istream & in, const std::function<bool (const char * data, size_t size)> & write)
+{
+    BufferRing ring;
+
+    // Read into free buffers on a separate thread
+    std::thread reader([&ring, &in] ()
+    {
+        size_t index = 0;
+
+        while (true)
+        {
+            // Wait for a free buffer
+            {
+                std::unique_lock<std::mutex> lock(ring.mutex);
+                ring.condition.wait(lock, [&ring] { return ring.filled < ring.buffers.size() || ring.cancelled; });
+                if (ring.cancelled) return;
+            }
+
+            // Read data
+            std::vector<char> & buffer = ring.buffers[index];
+            in.read(buffer.data(), buffer.size());
+            size_t count = static_cast<size_t>(in.gcount());
+
+            // Pass buffer to the writer
+            {
+                std::lock_guard<std::mutex> lock(ring.mutex);
+
+                ring.sizes[index] = count;
+                if (count > 0)             ring.filled++;
+                if (count < buffer.size()) ring.finished = true;
+            }
+
+            ring.condition.notify_all();
+
+            if (count < buffer.size()) return;
+            index = (index + 1) % ring.buffers.size();
+        }
+    });
+
+    // Write filled buffers
+    bool result = true;
+
+    while (true)
+    {
+        // Wait for a filled buffer
+        {
+            std::unique_lock<std::mutex> lock(ring.mutex);
+            ring.condition.wait(lock, [&ring] { return ring.filled > 0 || ring.finished; });
+            if (ring.filled == 0) break;
+        }
+
+        // Write data
+        bool written = write(ring.buffers[ring.first].data(), ring.sizes[ring.first]);
+
+        // Return buffer to the reader
+        {
+            std::lock_guard<std::mutex> lock(ring.mutex);
+
+            ring.first = (ring.first + 1) % ring.buffers.size();
+            ring.filled--;
+            if (!written) ring.cancelled = true;
+        }
+
+        ring.condition.notify_all();
+
+        if (!written)
+        {
+            result = false;
+            break;
+        }
+    }
+
+    reader.join();
+
+    return result && in.eof();
+}
+
+// Check if a block contains only zeros
+bool isZero(const char * data, size_t size)
+{
+    return size > 0 && data[0] == 0 && std::memcmp(data, data + 1, size - 1) == 0;
+}
+
+// Write data at the given offset, but skip blocks that only contain zeros,
+// so that they become holes in the destination file ('hole' is set while the
+// stream position is behind the offset, because blocks have been skipped)
+bool writeSparse(std::ostream & out, const char * data, size_t size, unsigned long long offset, bool & hole)
+{
+    size_t pos = 0;
+
+    while (pos < size)
+    {
+        // Skip zero blocks
+        size_t length = std::min(sparseBlockSize, size - pos);
+
+        if (isZero(data + pos, length))
+        {
+            hole = true;
+            pos += length;
+            continue;
+        }
+
+        // Write all following blocks that contain data at once
+        size_t end = pos + length;
+
+        while (end < size)
+        {
+            length = std::min(sparseBlockSize, size - end);
+            if (isZero(data + end, length)) break;
+
+            end += length;
+        }
+
+        if (hole)
+        {
+            out.seekp(offset + pos);
+            hole = false;
+        }
+
+        out.write(data + pos, end - pos);
+        pos = end;
+    }
+
+    return !out.fail();
+}
+
+// Get size of a stream (-1 if it cannot be determined)
+long long streamSize(std::istream & stream)
+{
+    stream.seekg(0, std::ios::end);
+    long long size = static_cast<long long>(stream.tellg());
+
+    stream.clear();
+    stream.seekg(0);
+
+    return size;
+}
+
+// Copy file in ranges on several threads, each with its own handles and streams
+bool parallelCopy(const cppfs::FileHandle & src, cppfs::FileHandle & dest, unsigned long long size, const cppfs::CopyOptions & options)
+{
+    // Create destination file with its final size, so that ranges can be written in any order
+    {
+        auto out = dest.createOutputStream(std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+
+        out->seekp(size - 1);
+        out->put('\0');
+        out->flush();
+
+        if (out->fail()) return false;
+    }
+
+    std::atomic<unsigned long long> next(0);
+    std::atomic<bool>               failed(false);
+
+    auto worker = [&] ()
+    {
+        cppfs::FileHandle srcFile = src.fs()->open(src.path());
+        cppfs::FileHandle dstFile = dest.fs()->open(dest.path());
+
+        auto in  = srcFile.createInputStream(std::ios::binary);
+        auto out = dstFile.createOutputStream(std::ios::binary | std::ios::in);
+
+        if (!in || !out)
+        {
+            failed = true;
+            return;
+        }
+
+        std::vector<char> buffer(copyBufferSize);
+
+        // Copy ranges until the whole file has been distributed
+        while (!failed)
+        {
+            unsigned long long offset = next.fetch_add(options.chunkSize());
+            if (offset >= size) break;
+
+            unsigned long long remaining = std::min<unsigned long long>(options.chunkSize(), size - offset);
+
+            in->seekg(offset);
+
+            // The file has already been sized, so zero blocks can simply be skipped
+            bool hole = true;
+
+            while (remaining > 0 && *in && *out)
+            {
+                in->read(buffer.data(), static_cast<std::streamsize>(std::min<unsigned long long>(remaining, buffer.size())));
+
+                size_t count = static_cast<size_t>(in->gcount());
+                if (count == 0) break;
+
+                writeSparse(*out, buffer.data(), count, offset, hole);
+                offset    += count;
+                remaining -= count;
+            }
+
+            out->flush();
+
+            if (remaining > 0 || out->fail())
+            {
+                failed = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < options.workers(); i++)
+    {
+        workers.emplace_back(worker);
+    }
+
+    for (auto & thread : workers)
+    {
+        thread.join();
+    }
+
+    dest.updateFileInfo();
+
+    return !failed;
+}
+
+// Get offset at which an interrupted copy can be continued (0 to start over)
+unsigned long long resumeOffset(std::istream & in, cppfs::FileHandle & dest, const cppfs::FileHandle & progress, const std::string & source)
+{
+    // Check for progress record
+    if (!progress.isFile() || !dest.isFile()) return 0;
+
+    // Read progress record ('<source size> <source modification time> <offset>')
+    std::string record = progress.readFile();
+    size_t pos = record.find_last_of(' ');
+    if (pos == std::string::npos || record.substr(0, pos) != source) return 0;
+
+    unsigned long long offset = std::strtoull(record.c_str() + pos + 1, nullptr, 10);
+    if (offset == 0) return 0;
+
+    // Compare the end of the copied data with the source file
+    auto out = dest.createInputStream(std::ios::binary);
+    if (!out) return 0;
+
+    size_t size = static_cast<size_t>(std::min<unsigned long long>(offset, verifySize));
+    std::vector<char> expected(size), actual(size);
+
+    if (readAt(in,   offset - size, expected.data(), size) != size) return 0;
+    if (readAt(*out, offset - size, actual.data(),   size) != size) return 0;
+    if (std::memcmp(expected.data(), actual.data(), size) != 0)     return 0;
+
+    return offset;
+}
+
+
+// Collect files of a tree together with their paths in the file system
+void collectFiles(cppfs::Tree & tree, const std::string & path, std::vector<cppfs::Tree *> & files, std::vector<std::string> & paths)
+{
+    for (auto & child : tree.children())
+    {
+        std::string childPath = cppfs::FilePath(path).resolve(child->fileName()).fullPath();
+
+        if (child->isDirectory())
+        {
+            collectFiles(*child, childPath, files, paths);
+        }
+        else
+        {
+            files.push_back(child.get());
+            paths.push_back(childPath);
+        }
+    }
+}
+
+// Check if a copied file or directory tree has the same entries and file sizes as the original
+bool sameTree(const cppfs::FileHandle & src, const cppfs::FileHandle & dst)
+{
+    // Re-created links are not followed, as relative links may point outside of the tree
+    if (src.isSymbolicLink() && dst.isSymbolicLink())
+    {
+        return true;
+    }
+
+    if (src.isFile())
+    {
+        return dst.isFile() && src.size() == dst.size();
+    }
+
+    if (src.isDirectory())
+    {
+        if (!dst.isDirectory()) return false;
+
+        for (const auto & filename : src.listFiles())
+        {
+            if (!sameTree(src.open(filename), dst.open(filename))) return false;
+        }
+
+        return true;
+    }
+
+    // Other entries (e.g., broken links) are not copied
+    return true;
+}
+
+
+} // namespace
+
+
 namespace cppfs
 {
 
@@ -169,6 +544,37 @@ std::unique_ptr<Tree> FileHandle::readTree(const std::string & path, bool includ
         return nullptr;
     }
 
+    // Let the file system read the whole tree, if it can
+    auto fastTree = m_backend->fs()->readTree(m_backend->path(), path);
+    if (fastTree)
+    {
+        if (includeHash)
+        {
+            // Compute hashes of all files at once
+            std::vector<Tree *>      files;
+            std::vector<std::string> paths;
+
+            if (fastTree->isDirectory())
+            {
+                collectFiles(*fastTree, m_backend->path(), files, paths);
+            }
+            else
+            {
+                files.push_back(fastTree.get());
+                paths.push_back(m_backend->path());
+            }
+
+            auto hashes = m_backend->fs()->sha1(paths);
+
+            for (size_t i = 0; i < files.size(); i++)
+            {
+                files[i]->setSha1(hashes[i].empty() ? m_backend->fs()->open(paths[i]).computeSha1() : hashes[i]);
+            }
+        }
+
+        return fastTree;
+    }
+
     // Create tree
     auto tree = std::unique_ptr<Tree>(new Tree);
     tree->setPath(path);
@@ -190,6 +596,8 @@ std::unique_ptr<Tree> FileHandle::readTree(const std::string & path, bool includ
     if (isDirectory())
     {
         // Add children
+        std::vector<Tree *> files;
+
         for (auto it = begin(); it != end(); ++it)
         {
             // Open file or directory
@@ -201,15 +609,34 @@ std::unique_ptr<Tree> FileHandle::readTree(const std::string & path, bool includ
             if (!subName.empty()) subName += "/";
             subName += fh.fileName();
 
-            // Read subtree
-            auto subTree = fh.readTree(subName, includeHash);
+            // Read subtree (hashes of files are computed for all files at once,
+            // special files such as FIFOs are not read)
+            auto subTree = fh.readTree(subName, includeHash && fh.isDirectory());
 
             // Add subtree to list
             if (subTree)
             {
+                if (fh.isFile()) files.push_back(subTree.get());
                 tree->add(std::move(subTree));
             }
         }
+
+        // Compute hashes of files
+        if (includeHash && !files.empty())
+        {
+            std::vector<std::string> paths;
+            for (auto * file : files)
+            {
+                paths.push_back(open(file->fileName()).path());
+            }
+
+            auto hashes = m_backend->fs()->sha1(paths);
+
+            for (size_t i = 0; i < files.size(); i++)
+            {
+                files[i]->setSha1(hashes[i].empty() ? open(files[i]->fileName()).computeSha1() : hashes[i]);
+            }
+        }
     }
 
     // Return tree
@@ -279,6 +706,18 @@ std::string FileHandle::sha1() const
         return "";
     }
 
+    // Let the file system compute the hash, if it can
+    std::string hash = m_backend->fs()->sha1(std::vector<std::string>{ m_backend->path() })[0];
+    if (!hash.empty())
+    {
+        return hash;
+    }
+
+    return computeSha1();
+}
+
+std::string FileHandle::computeSha1() const
+{
 #ifdef CPPFS_USE_OpenSSL
     // Open file
     auto inputStream = createInputStream();
@@ -391,12 +830,26 @@ bool FileHandle::removeDirectory()
     return true;
 }
 
-void FileHandle::copyDirectoryRec(FileHandle & dstDir)
+bool FileHandle::copyDirectoryRec(FileHandle & dstDir, const CopyOptions & options)
 {
     // Check if source directory is valid
     if (!isDirectory())
     {
-        return;
+        return false;
+    }
+
+    // If both handles are from the same file system, try to copy the tree at once.
+    // If the backend has started to copy, its result is final, because the generic
+    // copy would follow links that have been re-created in the destination.
+    if (dstDir.m_backend && m_backend->fs() == dstDir.m_backend->fs())
+    {
+        AbstractFileHandleBackend::CopyResult result = m_backend->copyDirectoryRec(*dstDir.m_backend.get(), options);
+
+        if (result != AbstractFileHandleBackend::CopyNotSupported)
+        {
+            dstDir.updateFileInfo();
+            return (result == AbstractFileHandleBackend::CopySucceeded);
+        }
     }
 
     // Check destination directory and try to create it if necessary
@@ -406,11 +859,13 @@ void FileHandle::copyDirectoryRec(FileHandle & dstDir)
 
         if (!dstDir.isDirectory())
         {
-            return;
+            return false;
         }
     }
 
     // Copy all entries
+    bool result = true;
+
     for (auto it = begin(); it != end(); ++it)
     {
         std::string filename = *it;
@@ -420,14 +875,37 @@ void FileHandle::copyDirectoryRec(FileHandle & dstDir)
 
         if (src.isDirectory())
         {
-            src.copyDirectoryRec(dst);
+            if (!src.copyDirectoryRec(dst, options)) result = false;
         }
 
         else if (src.isFile())
         {
-            src.copy(dst);
+            if (!src.copy(dst, options)) result = false;
         }
     }
+
+    return result;
+}
+
+bool FileHandle::cloneDirectory(FileHandle & dstDir, const CopyOptions & options, unsigned long long * clonedBytes, unsigned long long * copiedBytes)
+{
+    // Check if source directory is valid
+    if (!isDirectory() || !dstDir.m_backend || m_backend->fs() != dstDir.m_backend->fs())
+    {
+        return false;
+    }
+
+    // Clone directory tree
+    unsigned long long cloned = 0;
+    unsigned long long copied = 0;
+
+    bool result = m_backend->cloneDirectory(*dstDir.m_backend.get(), options, cloned, copied);
+
+    if (clonedBytes) *clonedBytes = cloned;
+    if (copiedBytes) *copiedBytes = copied;
+
+    dstDir.updateFileInfo();
+    return result;
 }
 
 void FileHandle::removeDirectoryRec(bool followSymlinks)
@@ -443,6 +921,11 @@ void FileHandle::removeDirectoryRec(bool followSymlinks)
         return;
     }
 
+    // Try to remove the tree at once
+    if (!followSymlinks && m_backend->removeDirectoryRec()) {
+        return;
+    }
+
     // Delete all entries
     for (auto it = begin(); it != end(); ++it)
     {
@@ -469,7 +952,29 @@ void FileHandle::removeDirectoryRec(bool followSymlinks)
         removeDirectory();
 }
 
-bool FileHandle::copy(FileHandle & dest)
+bool FileHandle::removeDirectoryRecAsync()
+{
+    // Check directory
+    if (!isDirectory()) {
+        return false;
+    }
+
+    // Check symlink
+    if (isSymbolicLink()) {
+        return remove();
+    }
+
+    // Move directory out of the way
+    if (m_backend->removeDirectoryRecAsync()) {
+        return true;
+    }
+
+    // Remove directory synchronously
+    removeDirectoryRec();
+    return !exists();
+}
+
+bool FileHandle::copy(FileHandle & dest, const CopyOptions & options)
 {
     // Check backend
     if (!m_backend)
@@ -480,7 +985,7 @@ bool FileHandle::copy(FileHandle & dest)
     // If both handles are from the same file system, use internal method
     if (m_backend->fs() == dest.m_backend->fs())
     {
-        bool result = m_backend->copy(*dest.m_backend.get());
+        bool result = m_backend->copy(*dest.m_backend.get(), options);
         dest.updateFileInfo();
         return result;
     }
@@ -488,11 +993,11 @@ bool FileHandle::copy(FileHandle & dest)
     // Otherwise, use generic (slow) method
     else
     {
-        return genericCopy(dest);
+        return genericCopy(dest, options);
     }
 }
 
-bool FileHandle::move(FileHandle & dest)
+bool FileHandle::move(FileHandle & dest, const CopyOptions & options)
 {
     // Check backend
     if (!m_backend)
@@ -503,15 +1008,25 @@ bool FileHandle::move(FileHandle & dest)
     // If both handles are from the same file system, use internal method
     if (m_backend->fs() == dest.m_backend->fs())
     {
-        bool result = m_backend->move(*dest.m_backend.get());
+        errno = 0;
+
+        bool result      = m_backend->move(*dest.m_backend.get());
+        bool otherDevice = !result && errno == EXDEV;
         dest.updateFileInfo();
+
+        // Copy and delete if the destination is on another device
+        if (otherDevice)
+        {
+            return genericMove(dest, options);
+        }
+
         return result;
     }
 
     // Otherwise, use generic (slow) method
     else
     {
-        return genericMove(dest);
+        return genericMove(dest, options);
     }
 }
 
@@ -678,7 +1193,36 @@ bool FileHandle::writeFileBase64(const std::string & base64)
     return true;
 }
 
-bool FileHandle::genericCopy(FileHandle & dest)
+bool FileHandle::writeFileAtomic(const std::string & content, bool sync)
+{
+    // Check backend
+    if (!m_backend || isDirectory())
+    {
+        return false;
+    }
+
+    // Try to write an unnamed file
+    if (m_backend->writeFileAtomic(content, sync))
+    {
+        return true;
+    }
+
+    // Otherwise, write a hidden file and rename it
+    FileWriteBatch batch(sync);
+    return batch.add(*this, content) && batch.commit();
+}
+
+bool FileHandle::syncFileSystem()
+{
+    return m_backend ? m_backend->syncFileSystem() : false;
+}
+
+unsigned long long FileHandle::deviceId() const
+{
+    return m_backend ? m_backend->deviceId() : 0;
+}
+
+bool FileHandle::genericCopy(FileHandle & dest, const CopyOptions & options)
 {
     // Check backend
     if (!m_backend)
@@ -686,36 +1230,184 @@ bool FileHandle::genericCopy(FileHandle & dest)
         return false;
     }
 
-    // Open files
-    auto in  = createInputStream(std::ios::binary);
-    auto out = dest.createOutputStream(std::ios::binary | std::ios::trunc);
+    // Open source file
+    auto in = createInputStream(std::ios::binary);
+    if (!in || !dest.m_backend)
+    {
+        // Error!
+        return false;
+    }
+
+    // Copy large files in ranges, if requested
+    if (options.workers() > 1)
+    {
+        long long size = streamSize(*in);
+
+        if (size >= 0 && static_cast<unsigned long long>(size) >= 2 * options.chunkSize())
+        {
+            in.reset();
+            return parallelCopy(*this, dest, static_cast<unsigned long long>(size), options);
+        }
+    }
+
+    // Continue an interrupted copy if the source file has not changed since and
+    // the copied data is still intact, otherwise start over with an empty file.
+    // Progress is only recorded for large files, so the record is not looked for
+    // if the destination is too small to have one.
+    FileHandle progress = dest.m_backend->fs()->open(dest.path() + progressSuffix);
+    std::string source = std::to_string(size()) + " " + std::to_string(modificationTime());
 
-    if (!in || !out)
+    unsigned long long offset   = 0;
+    bool               recorded = false;
+
+    if (dest.isFile() && dest.size() > verifySize)
+    {
+        recorded = progress.isFile();
+        offset   = resumeOffset(*in, dest, progress, source);
+    }
+
+    auto out = dest.createOutputStream(offset > 0 ? (std::ios::binary | std::ios::in) : (std::ios::binary | std::ios::trunc));
+    if (!out)
     {
         // Error!
         return false;
     }
 
-    // Copy file
-    (*out) << in->rdbuf();
+    in->clear();
+    in->seekg(offset);
+
+    if (offset > 0)
+    {
+        out->seekp(offset);
+    }
+
+    // Copy file while the next data is read in the background, skip zero blocks
+    // to keep sparse files sparse, and record the progress regularly, so that an
+    // interrupted copy can be continued. When continuing, the file still contains
+    // the old data after the offset, so zero blocks have to be written as well.
+    unsigned long long nextRecord = offset + progressInterval;
+    bool               sparse     = (offset == 0);
+    bool               hole       = false;
+
+    bool result = pipelineCopy(*in, [&] (const char * data, size_t count)
+    {
+        if (sparse) writeSparse(*out, data, count, offset, hole);
+        else        out->write(data, count);
+
+        offset += count;
+
+        if (offset >= nextRecord)
+        {
+            out->flush();
+
+            if (*out)
+            {
+                progress.writeFile(source + " " + std::to_string(offset));
+                recorded = true;
+            }
+
+            nextRecord = offset + progressInterval;
+        }
+
+        return !out->fail();
+    });
+
+    // Extend the file if it ends with skipped blocks
+    if (hole)
+    {
+        out->seekp(offset - 1);
+        out->put('\0');
+    }
+
     out->flush();
 
+    result = result && !out->fail();
+    out.reset();
+
+    // Remove progress record
+    if (result && recorded)
+    {
+        progress.updateFileInfo();
+        progress.remove();
+    }
+
     // Reload information on destination file
     dest.updateFileInfo();
 
     // Done
-    return true;
+    return result;
 }
 
-bool FileHandle::genericMove(FileHandle & dest)
+bool FileHandle::genericMove(FileHandle & dest, const CopyOptions & options)
 {
-    // Copy file
-    if (!genericCopy(dest))
+    // Check source and destination
+    if (!m_backend || !dest.m_backend || (!isFile() && !isDirectory()))
+    {
+        return false;
+    }
+
+    // Get destination path (move into the directory if the destination is one)
+    auto       destFS = dest.m_backend->fs();
+    FileHandle target = destFS->open(dest.isDirectory() ? FilePath(dest.path()).resolve(FilePath(path()).fileName()).fullPath() : dest.path());
+
+    if (isDirectory() && target.exists())
+    {
+        return false;
+    }
+
+    // Copy to a hidden name next to the destination, so that incomplete data is never visible under its name
+    std::string filename = FilePath(target.path()).fileName();
+    FileHandle  staging  = destFS->open(FilePath(target.path()).directoryPath() + "." + filename + movingSuffix);
+
+    bool copied = false;
+
+    if (isDirectory())
+    {
+        staging.removeDirectoryRec();
+
+        CopyOptions treeOptions = options;
+        treeOptions.setPreserveMetadata(true).setPreserveLinks(true);
+
+        // A failed copy is not continued by another one, which could write through re-created links
+        copied = copyDirectoryRec(staging, treeOptions);
+    }
+    else
+    {
+        copied = copy(staging, options);
+    }
+
+    // Verify the copy and put it in place (a failed copy may already have its full size)
+    bool verified = copied && sameTree(*this, staging);
+    bool placed   = verified && staging.rename(filename);
+
+    // Some servers do not replace existing files on rename (e.g., SFTP version 3), so remove the file first
+    if (verified && !placed && isFile())
+    {
+        target.updateFileInfo();
+
+        if (target.isFile() && target.remove())
+        {
+            placed = staging.rename(filename);
+        }
+    }
+
+    if (!placed)
     {
+        if (staging.isDirectory()) staging.removeDirectoryRec();
+        else                       staging.remove();
+
         return false;
     }
 
-    // Remove source file
+    dest.updateFileInfo();
+
+    // Remove source
+    if (isDirectory())
+    {
+        removeDirectoryRec();
+        return !exists();
+    }
+
     return remove();
 }
 
@@ -112,5 +112,10 @@ AbstractFileSystem * FileIterator::fs() const
     return m_backend ? m_backend->fs() : nullptr;
 }
 
+bool FileIterator::entryInfo(AbstractFileIteratorBackend::EntryInfo & info) const
+{
+    return m_backend && m_backend->valid() && m_backend->entryInfo(info);
+}
+
 
 } // namespace cppfs
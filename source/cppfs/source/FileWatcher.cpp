@@ -14,18 +14,33 @@ namespace cppfs
 
 
 FileWatcher::FileWatcher()
-: m_backend(fs::localFS()->createFileWatcher(*this))
+: m_backend(fs::localFS()->createFileWatcher(*this, DefaultWatcher))
+, m_settleTime(0)
+, m_emulateClosedWrite(false)
+, m_fileEventHook(true)
+, m_fileMovedHook(true)
 {
 }
 
-FileWatcher::FileWatcher(AbstractFileSystem * fs)
-: m_backend(fs ? fs->createFileWatcher(*this) : nullptr)
+FileWatcher::FileWatcher(AbstractFileSystem * fs, WatcherType type)
+: m_backend(fs ? fs->createFileWatcher(*this, type) : nullptr)
+, m_settleTime(0)
+, m_emulateClosedWrite(false)
+, m_fileEventHook(true)
+, m_fileMovedHook(true)
 {
 }
 
 FileWatcher::FileWatcher(FileWatcher && fileWatcher)
 : m_backend(std::move(fileWatcher.m_backend))
 , m_eventHandlers(std::move(fileWatcher.m_eventHandlers))
+, m_settleTime(fileWatcher.m_settleTime)
+, m_emulateClosedWrite(fileWatcher.m_emulateClosedWrite)
+, m_fileEventHook(true)
+, m_fileMovedHook(true)
+, m_events(std::move(fileWatcher.m_events))
+, m_settlingFiles(std::move(fileWatcher.m_settlingFiles))
+, m_watchedEvents(std::move(fileWatcher.m_watchedEvents))
 , m_ownEventHandlers(std::move(fileWatcher.m_ownEventHandlers))
 {
     // Fix pointer to file watcher
@@ -41,9 +56,14 @@ FileWatcher::~FileWatcher()
 FileWatcher & FileWatcher::operator=(FileWatcher && fileWatcher)
 {
     // Move backend
-    m_backend          = std::move(fileWatcher.m_backend);
-    m_eventHandlers    = std::move(fileWatcher.m_eventHandlers);
-    m_ownEventHandlers = std::move(fileWatcher.m_ownEventHandlers);
+    m_backend            = std::move(fileWatcher.m_backend);
+    m_eventHandlers      = std::move(fileWatcher.m_eventHandlers);
+    m_settleTime         = fileWatcher.m_settleTime;
+    m_emulateClosedWrite = fileWatcher.m_emulateClosedWrite;
+    m_events             = std::move(fileWatcher.m_events);
+    m_settlingFiles      = std::move(fileWatcher.m_settlingFiles);
+    m_watchedEvents      = std::move(fileWatcher.m_watchedEvents);
+    m_ownEventHandlers   = std::move(fileWatcher.m_ownEventHandlers);
 
     // Fix pointer to file watcher
     if (m_backend) {
@@ -59,6 +79,21 @@ AbstractFileSystem * FileWatcher::fs() const
     return m_backend ? m_backend->fs() : nullptr;
 }
 
+AbstractFileWatcherBackend * FileWatcher::backend() const
+{
+    return m_backend.get();
+}
+
+int FileWatcher::settleTime() const
+{
+    return m_settleTime;
+}
+
+void FileWatcher::setSettleTime(int settleTime)
+{
+    m_settleTime = settleTime > 0 ? settleTime : 0;
+}
+
 void FileWatcher::add(FileHandle & dir, unsigned int events, RecursiveMode recursive)
 {
     // Check backend
@@ -71,8 +106,20 @@ void FileWatcher::add(FileHandle & dir, unsigned int events, RecursiveMode recur
         return;
     }
 
+    // Remember the events that have been requested for the directory
+    m_watchedEvents[dir.path()] = events;
+
+    // Emulate FileClosedWrite by settle detection if it is not supported by the backend
+    // (the backend is asked for additional events, which are not passed to the handlers)
+    unsigned int backendEvents = events;
+
+    if ((events & FileClosedWrite) && m_settleTime > 0 && !(m_backend->supportedEvents() & FileClosedWrite)) {
+        m_emulateClosedWrite = true;
+        backendEvents |= FileCreated | FileModified;
+    }
+
     // Add directory to watcher
-    m_backend->add(dir, events, recursive);
+    m_backend->add(dir, backendEvents, recursive);
 }
 
 void FileWatcher::addHandler(FileEventHandler * eventHandler)
@@ -116,14 +163,195 @@ void FileWatcher::watch(int timeout)
     }
 
     // Watch files
-    m_backend->watch(timeout);
+    m_backend->watch(settleTimeout(timeout));
+
+    // Report files that have settled in the meantime
+    queueSettledFiles();
+
+    // Call event handlers
+    dispatchEvents();
+}
+
+int FileWatcher::nativeHandle() const
+{
+    return m_backend ? m_backend->nativeHandle() : -1;
+}
+
+void FileWatcher::processPending()
+{
+    // Check backend
+    if (!m_backend) {
+        return;
+    }
+
+    // Process events
+    m_backend->processPending();
+
+    // Report files that have settled in the meantime
+    queueSettledFiles();
+
+    // Call event handlers
+    dispatchEvents();
 }
 
-void FileWatcher::onFileEvent(FileHandle & fh, FileEvent event)
+void FileWatcher::onFileEvents(const std::vector<FileEventInfo> & events)
 {
+    // Call per-event hooks (the default implementations switch them off,
+    // so file handles are only opened if a derived class overrides them)
+    for (auto & event : events) {
+        if (!m_fileEventHook && !m_fileMovedHook) {
+            break;
+        }
+
+        if (event.event() == FileMoved && !event.fromPath().empty()) {
+            if (m_fileMovedHook) {
+                FileHandle fh   = event.fileHandle();
+                FileHandle from = event.fromFileHandle();
+                onFileMoved(from, fh);
+            }
+        } else if (m_fileEventHook) {
+            FileHandle fh = event.fileHandle();
+            onFileEvent(fh, event.event());
+        }
+    }
+
     // Call file event handlers
     for (auto * eventHandler : m_eventHandlers) {
-        eventHandler->onFileEvent(fh, event);
+        eventHandler->onFileEvents(events);
+    }
+}
+
+void FileWatcher::onFileEvent(FileHandle &, FileEvent)
+{
+    // Not overridden, do not open file handles for it anymore
+    m_fileEventHook = false;
+}
+
+void FileWatcher::onFileMoved(FileHandle &, FileHandle &)
+{
+    // Not overridden, do not open file handles for it anymore
+    m_fileMovedHook = false;
+}
+
+void FileWatcher::queueEvent(FileEventInfo && event)
+{
+    // Track files until they have settled
+    if (m_emulateClosedWrite) {
+        switch (event.event()) {
+            case FileCreated:
+            case FileModified:
+                m_settlingFiles[event.path()] = event.timestamp();
+                break;
+
+            case FileRemoved:
+                m_settlingFiles.erase(event.path());
+                break;
+
+            case FileMoved: {
+                // Keep tracking file at its new location
+                auto it = m_settlingFiles.find(event.fromPath());
+                if (it != m_settlingFiles.end()) {
+                    auto lastEvent = it->second;
+                    m_settlingFiles.erase(it);
+                    m_settlingFiles[event.path()] = lastEvent;
+                }
+                break;
+            }
+
+            default:
+                break;
+        }
+
+        // Drop events that have only been requested for settle detection
+        if (!isWatched(event)) {
+            return;
+        }
+    }
+
+    // Add event to list
+    m_events.push_back(std::move(event));
+}
+
+bool FileWatcher::isWatched(const FileEventInfo & event) const
+{
+    const std::string & path = event.path();
+
+    // Check directories that contain the file
+    for (auto & it : m_watchedEvents) {
+        const std::string & dir = it.first;
+
+        bool inside = path.compare(0, dir.size(), dir) == 0 &&
+                      (path.size() == dir.size() || path[dir.size()] == '/' || (!dir.empty() && dir.back() == '/'));
+
+        if (inside && (it.second & event.event())) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void FileWatcher::dispatchEvents()
+{
+    // Check if there are any events
+    if (m_events.empty()) {
+        return;
+    }
+
+    // Take events, so that handlers can safely call watch() again
+    std::vector<FileEventInfo> events;
+    events.swap(m_events);
+
+    // Call event handlers
+    onFileEvents(events);
+
+    // Reuse memory for the next events
+    if (m_events.empty()) {
+        events.clear();
+        m_events.swap(events);
+    }
+}
+
+int FileWatcher::settleTimeout(int timeout) const
+{
+    // Check if any files are waiting to settle
+    if (m_settlingFiles.empty()) {
+        return timeout;
+    }
+
+    // Get time until the next file settles
+    auto now  = std::chrono::steady_clock::now();
+    auto next = std::chrono::milliseconds(m_settleTime);
+
+    for (auto & it : m_settlingFiles) {
+        auto remaining = it.second + std::chrono::milliseconds(m_settleTime) - now;
+        next = std::min(next, std::chrono::duration_cast<std::chrono::milliseconds>(remaining) + std::chrono::milliseconds(1));
+    }
+
+    int settle = static_cast<int>(std::max(next.count(), static_cast<decltype(next.count())>(0)));
+    return (timeout >= 0 && timeout < settle) ? timeout : settle;
+}
+
+void FileWatcher::queueSettledFiles()
+{
+    auto now = std::chrono::steady_clock::now();
+
+    for (auto it = m_settlingFiles.begin(); it != m_settlingFiles.end(); ) {
+        // Check if file has settled
+        if (now - it->second < std::chrono::milliseconds(m_settleTime)) {
+            ++it;
+            continue;
+        }
+
+        // Report only files that still exist, in directories that watch FileClosedWrite
+        FileEventInfo event(fs(), FileClosedWrite, it->first);
+        FileHandle fh = fs()->open(it->first);
+
+        if (fh.isFile() && isWatched(event)) {
+            m_events.push_back(std::move(event));
+        }
+
+        it = m_settlingFiles.erase(it);
     }
 }
 
@@ -0,0 +1,132 @@
+
+#include <cppfs/FileWriteBatch.h>
+
+#include <ostream>
+#include <random>
+#include <set>
+#include <utility>
+
+#include <cppfs/FilePath.h>
+#include <cppfs/AbstractFileSystem.h>
+
+
+namespace cppfs
+{
+
+
+FileWriteBatch::FileWriteBatch(bool sync)
+: m_sync(sync)
+, m_id(std::to_string(std::random_device()()))
+{
+}
+
+FileWriteBatch::~FileWriteBatch()
+{
+    discard();
+}
+
+bool FileWriteBatch::add(const FileHandle & file, const std::string & content)
+{
+    // Check file (renaming would replace a link instead of its target)
+    if (!file.fs() || file.isDirectory() || file.isSymbolicLink())
+    {
+        return false;
+    }
+
+    // Write content to a hidden file in the same directory, so that it can be renamed
+    FilePath path(file.path());
+    std::string name = path.directoryPath() + "." + path.fileName() + ".cppfs-" + m_id + "-" + std::to_string(m_entries.size());
+
+    FileHandle temp = file.fs()->open(name);
+
+    {
+        auto out = temp.createOutputStream(std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+
+        out->write(content.data(), content.size());
+        out->flush();
+
+        if (!out->good())
+        {
+            out.reset();
+            temp.remove();
+            return false;
+        }
+    }
+
+    // Keep permissions of the existing file
+    if (file.isFile())
+    {
+        temp.setPermissions(file.permissions());
+    }
+
+    m_entries.push_back(Entry{ file, temp });
+    return true;
+}
+
+bool FileWriteBatch::commit()
+{
+    // Flush new files once for all of them
+    if (m_sync && !syncDirectories())
+    {
+        discard();
+        return false;
+    }
+
+    // Replace files
+    for (size_t i = 0; i < m_entries.size(); i++)
+    {
+        Entry & entry = m_entries[i];
+
+        if (!entry.temp.rename(FilePath(entry.file.path()).fileName()))
+        {
+            m_entries.erase(m_entries.begin(), m_entries.begin() + i);
+            discard();
+            return false;
+        }
+
+        entry.file.updateFileInfo();
+    }
+
+    // Flush directories, so that the new names are on disk as well
+    bool result = !m_sync || syncDirectories();
+
+    m_entries.clear();
+    return result;
+}
+
+bool FileWriteBatch::syncDirectories()
+{
+    // Flush each file system once (identified by the file system object and the device)
+    std::set<std::string> dirs;
+    std::set<std::pair<AbstractFileSystem *, unsigned long long>> fileSystems;
+
+    for (auto & entry : m_entries)
+    {
+        std::string dir = FilePath(entry.file.path()).directoryPath();
+        if (!dirs.insert(dir).second) continue;
+
+        FileHandle dirHandle = entry.file.fs()->open(dir.empty() ? "." : dir);
+        if (!fileSystems.insert(std::make_pair(entry.file.fs(), dirHandle.deviceId())).second) continue;
+
+        if (!dirHandle.syncFileSystem())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void FileWriteBatch::discard()
+{
+    for (auto & entry : m_entries)
+    {
+        entry.temp.remove();
+    }
+
+    m_entries.clear();
+}
+
+
+} // namespace cppfs
@@ -0,0 +1,340 @@
+
+#include <cppfs/PollingFileWatcher.h>
+
+#include <algorithm>
+#include <thread>
+
+#include <cppfs/FileHandle.h>
+#include <cppfs/FileIterator.h>
+#include <cppfs/FileWatcher.h>
+#include <cppfs/AbstractFileSystem.h>
+
+
+namespace
+{
+
+
+// Get path of a file inside a directory
+std::string joinPath(const std::string & dir, const std::string & name)
+{
+    if (!dir.empty() && dir.back() == '/') {
+        return dir + name;
+    }
+
+    return dir + "/" + name;
+}
+
+// Check if a path is equal to or located inside a directory
+bool isInside(const std::string & dir, const std::string & path)
+{
+    return path.compare(0, dir.size(), dir) == 0 &&
+           (path.size() == dir.size() || path[dir.size()] == '/');
+}
+
+
+} // namespace
+
+
+namespace cppfs
+{
+
+
+PollingFileWatcher::PollingFileWatcher(FileWatcher * fileWatcher, std::shared_ptr<AbstractFileSystem> fs)
+: AbstractFileWatcherBackend(fileWatcher)
+, m_fs(std::move(fs))
+, m_minInterval(1000)
+, m_maxInterval(30000)
+, m_interval(1000)
+, m_statBudget(10000)
+, m_changed(false)
+, m_nextPoll(std::chrono::steady_clock::now())
+{
+}
+
+PollingFileWatcher::~PollingFileWatcher()
+{
+}
+
+void PollingFileWatcher::setPollInterval(int minInterval, int maxInterval)
+{
+    m_minInterval = std::max(minInterval, 0);
+    m_maxInterval = std::max(maxInterval, m_minInterval);
+    m_interval    = m_minInterval;
+
+    // Apply new interval to the next poll cycle
+    m_nextPoll = std::min(m_nextPoll, std::chrono::steady_clock::now() + std::chrono::milliseconds(m_interval));
+}
+
+int PollingFileWatcher::minPollInterval() const
+{
+    return m_minInterval;
+}
+
+int PollingFileWatcher::maxPollInterval() const
+{
+    return m_maxInterval;
+}
+
+void PollingFileWatcher::setStatBudget(unsigned int budget)
+{
+    m_statBudget = budget;
+}
+
+unsigned int PollingFileWatcher::statBudget() const
+{
+    return m_statBudget;
+}
+
+AbstractFileSystem * PollingFileWatcher::fs() const
+{
+    return m_fs.get();
+}
+
+void PollingFileWatcher::add(FileHandle & dir, unsigned int events, RecursiveMode recursive)
+{
+    // Create snapshot
+    std::string path = dir.path();
+
+    Directory & directory = m_dirs[path];
+    directory.events    = events;
+    directory.recursive = recursive;
+    directory.scanned   = false;
+    directory.report    = false;
+    directory.entries.clear();
+
+    // Take initial snapshot of the directory tree, so all changes from now on are detected
+    std::deque<std::string> queue;
+    queue.push_back(path);
+
+    unsigned int stats = 0;
+    while (!queue.empty() && (m_statBudget == 0 || stats < m_statBudget)) {
+        std::string subdir = std::move(queue.front());
+        queue.pop_front();
+
+        scan(subdir, stats, queue);
+    }
+
+    // Continue the snapshot of large trees in the next poll cycles
+    m_queue.insert(m_queue.begin(), queue.begin(), queue.end());
+
+    // Start polling with the minimum interval
+    m_interval = m_minInterval;
+    m_nextPoll = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_interval);
+}
+
+void PollingFileWatcher::watch(int timeout)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    while (true) {
+        // Run poll cycle when it is due
+        auto now = std::chrono::steady_clock::now();
+        if (now >= m_nextPoll) {
+            if (poll() > 0) {
+                return;
+            }
+
+            continue;
+        }
+
+        // Wait for next poll cycle or the timeout
+        auto wait = m_nextPoll - now;
+
+        if (timeout >= 0) {
+            auto deadline = start + std::chrono::milliseconds(timeout);
+            if (now >= deadline) {
+                return;
+            }
+
+            wait = std::min(wait, deadline - now);
+        }
+
+        std::this_thread::sleep_for(wait);
+    }
+}
+
+unsigned int PollingFileWatcher::poll()
+{
+    // Start new pass over all directories
+    if (m_queue.empty()) {
+        for (auto & it : m_dirs) {
+            m_queue.push_back(it.first);
+        }
+    }
+
+    // Scan directories until the budget is used up
+    unsigned int stats  = 0;
+    unsigned int events = 0;
+
+    while (!m_queue.empty() && (m_statBudget == 0 || stats < m_statBudget)) {
+        std::string path = std::move(m_queue.front());
+        m_queue.pop_front();
+
+        events += scan(path, stats, m_queue);
+    }
+
+    if (events > 0) {
+        m_changed = true;
+    }
+
+    // Schedule next poll cycle
+    auto now = std::chrono::steady_clock::now();
+
+    if (!m_queue.empty()) {
+        // Continue current pass
+        m_nextPoll = now + std::chrono::milliseconds(m_minInterval);
+    } else {
+        // Poll again soon if something has changed, otherwise slow down
+        m_interval = m_changed ? m_minInterval : std::min(m_interval * 2, m_maxInterval);
+        m_interval = std::max(m_interval, m_minInterval);
+        m_changed  = false;
+        m_nextPoll = now + std::chrono::milliseconds(m_interval);
+    }
+
+    return events;
+}
+
+unsigned int PollingFileWatcher::scan(const std::string & path, unsigned int & stats, std::deque<std::string> & queue)
+{
+    // Get directory (it may have been removed in the meantime)
+    auto it = m_dirs.find(path);
+    if (it == m_dirs.end()) {
+        return 0;
+    }
+
+    Directory & dir = it->second;
+
+    // List directory (a directory that is gone is treated as empty)
+    std::map<std::string, Entry> entries;
+
+    FileHandle fh = m_fs->open(path);
+    if (fh.isDirectory()) {
+        AbstractFileIteratorBackend::EntryInfo info;
+
+        for (auto it = fh.begin(); it != fh.end(); ++it) {
+            stats++;
+            Entry & entry = entries[*it];
+
+            // Get metadata from the listing
+            if (it.entryInfo(info)) {
+                entry.isDirectory = info.isDirectory;
+                entry.size        = entry.isDirectory ? 0 : info.size;
+                entry.modTime     = info.modificationTime;
+                entry.permissions = info.permissions;
+                entry.uid         = info.userId;
+                entry.gid         = info.groupId;
+                continue;
+            }
+
+            // Query metadata of the file
+            FileHandle child = m_fs->open(joinPath(path, *it));
+
+            entry.isDirectory = child.isDirectory() && !child.isSymbolicLink();
+            entry.size        = entry.isDirectory ? 0 : child.size();
+            entry.modTime     = child.modificationTime();
+            entry.permissions = child.permissions();
+            entry.uid         = child.userId();
+            entry.gid         = child.groupId();
+        }
+    }
+
+    // Compare with previous snapshot
+    unsigned int events = 0;
+    bool report = dir.scanned || dir.report;
+
+    for (auto & it : entries) {
+        const std::string & name  = it.first;
+        const Entry       & entry = it.second;
+        std::string childPath = joinPath(path, name);
+
+        auto old = dir.entries.find(name);
+
+        // Check for new files
+        if (old == dir.entries.end() || old->second.isDirectory != entry.isDirectory) {
+            // File has been replaced by a file of another type
+            if (old != dir.entries.end()) {
+                if (old->second.isDirectory) {
+                    removeDirectory(childPath);
+                }
+
+                if (report && (dir.events & FileRemoved)) {
+                    onFileEvent(childPath, FileRemoved, old->second.isDirectory);
+                    events++;
+                }
+            }
+
+            if (report && (dir.events & FileCreated)) {
+                onFileEvent(childPath, FileCreated, entry.isDirectory);
+                events++;
+            }
+
+            // Watch new directories
+            if (entry.isDirectory && dir.recursive == Recursive) {
+                Directory subdir;
+                subdir.events    = dir.events;
+                subdir.recursive = dir.recursive;
+                subdir.scanned   = false;
+                subdir.report    = report;
+
+                if (m_dirs.insert(std::make_pair(childPath, std::move(subdir))).second) {
+                    queue.push_back(childPath);
+                }
+            }
+
+            continue;
+        }
+
+        // Check for modified files
+        if (!report) {
+            continue;
+        }
+
+        if (!entry.isDirectory && (entry.size != old->second.size || entry.modTime != old->second.modTime) && (dir.events & FileModified)) {
+            onFileEvent(childPath, FileModified, entry.isDirectory);
+            events++;
+        }
+
+        if ((entry.permissions != old->second.permissions || entry.uid != old->second.uid || entry.gid != old->second.gid) && (dir.events & FileAttrChanged)) {
+            onFileEvent(childPath, FileAttrChanged, entry.isDirectory);
+            events++;
+        }
+    }
+
+    // Check for removed files
+    for (auto & it : dir.entries) {
+        if (entries.count(it.first) > 0) {
+            continue;
+        }
+
+        std::string childPath = joinPath(path, it.first);
+
+        if (it.second.isDirectory) {
+            removeDirectory(childPath);
+        }
+
+        if (report && (dir.events & FileRemoved)) {
+            onFileEvent(childPath, FileRemoved, it.second.isDirectory);
+            events++;
+        }
+    }
+
+    // Save snapshot
+    dir.entries = std::move(entries);
+    dir.scanned = true;
+
+    return events;
+}
+
+void PollingFileWatcher::removeDirectory(const std::string & path)
+{
+    for (auto it = m_dirs.begin(); it != m_dirs.end(); ) {
+        if (isInside(path, it->first)) {
+            it = m_dirs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+
+} // namespace cppfs
@@ -4,6 +4,13 @@
 #include <sstream>
 #include <iomanip>
 #include <iterator>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
 
 #include <basen/basen.hpp>
 
@@ -28,6 +35,79 @@
     #include <cppfs/windows/LocalFileSystem.h>
 #else
     #include <cppfs/posix/LocalFileSystem.h>
+    #include <cppfs/posix/LocalFileHandle.h>
+#endif
+
+
+#if defined(CPPFS_USE_OpenSSL)
+namespace
+{
+
+
+// Connections that have not been used for this time are checked before they are reused
+const std::chrono::seconds healthCheckInterval(5);
+
+// Shared SSH connection
+struct SshConnection
+{
+    std::weak_ptr<cppfs::SshFileSystem>   fs;          ///< File system (as long as anyone uses it)
+    std::shared_ptr<cppfs::SshFileSystem> idleRef;     ///< Keeps the connection open until the idle timeout
+    std::chrono::steady_clock::time_point lastUsed;    ///< Time of the last fs::open call
+    std::chrono::steady_clock::duration   idleTimeout; ///< Time to keep the connection open after the last use
+};
+
+// Registry of shared SSH connections
+struct SshConnectionRegistry
+{
+    std::mutex                           mutex;       ///< Protects the registry
+    std::map<std::string, SshConnection> connections; ///< Connections (key -> connection)
+};
+
+SshConnectionRegistry & sshConnections()
+{
+    static SshConnectionRegistry registry;
+
+    return registry;
+}
+
+// Read non-negative number (keeps the current value if the string is not a valid number)
+void readNumber(const std::string & str, int & value)
+{
+    char * end = nullptr;
+
+    errno = 0;
+    long number = std::strtol(str.c_str(), &end, 10);
+
+    if (str.empty() || *end != '\0' || errno == ERANGE || number > INT_MAX) return;
+
+    value = static_cast<int>(std::max(number, 0L));
+}
+
+// Release connections that have not been used for longer than their idle timeout
+void releaseIdleConnections(SshConnectionRegistry & registry, std::chrono::steady_clock::time_point now)
+{
+    for (auto it = registry.connections.begin(); it != registry.connections.end(); )
+    {
+        SshConnection & connection = it->second;
+
+        if (now - connection.lastUsed >= connection.idleTimeout)
+        {
+            connection.idleRef.reset();
+        }
+
+        if (connection.fs.expired())
+        {
+            it = registry.connections.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+
+} // namespace
 #endif
 
 
@@ -64,20 +144,106 @@ FileHandle open(const std::string & path, const LoginCredentials * credentials)
         std::string publicKey  = system::homeDir() + "/.ssh/id_rsa.pub";
         std::string privateKey = system::homeDir() + "/.ssh/id_rsa";
 
+        bool        reuse      = true;
+        int         idleTime   = 60;
+
         // Apply login credentials
         if (credentials)
         {
-            if (credentials->isSet("port"))       port = std::stoi(credentials->value("port"));
-            if (credentials->isSet("username"))   user = credentials->value("username");
-            if (credentials->isSet("password"))   pass = credentials->value("password");
-            if (credentials->isSet("publicKey"))  publicKey = credentials->value("publicKey");
-            if (credentials->isSet("privateKey")) privateKey = credentials->value("privateKey");
+            if (credentials->isSet("port"))        port = std::stoi(credentials->value("port"));
+            if (credentials->isSet("username"))    user = credentials->value("username");
+            if (credentials->isSet("password"))    pass = credentials->value("password");
+            if (credentials->isSet("publicKey"))   publicKey = credentials->value("publicKey");
+            if (credentials->isSet("privateKey"))  privateKey = credentials->value("privateKey");
+            if (credentials->isSet("reuse"))       reuse = (credentials->value("reuse") != "false");
+            if (credentials->isSet("idleTimeout")) readNumber(credentials->value("idleTimeout"), idleTime);
+        }
+
+        // Create private SSH connection
+        if (!reuse)
+        {
+            std::shared_ptr<SshFileSystem> fs(
+                new SshFileSystem(host, port, user, pass, publicKey, privateKey, credentials)
+            );
+
+            return fs->open(localPath);
+        }
+
+        // Get key of the connection (options are included, as they change the behavior of the file system)
+        std::string key = user + "@" + host + ":" + std::to_string(port) + "\n" + sha1(pass) + "\n" + publicKey + "\n" + privateKey;
+
+        if (credentials)
+        {
+            for (auto option : { "readAhead", "writeAhead", "sync", "sessions", "attributeCacheTime", "asyncChannels",
+                                 "ciphers", "macs", "kex", "hostKeys", "compression", "windowSize" })
+            {
+                key += "\n" + (credentials->isSet(option) ? credentials->value(option) : std::string());
+            }
+        }
+
+        // Look for an existing connection
+        SshConnectionRegistry & registry = sshConnections();
+        std::shared_ptr<SshFileSystem> fs;
+        bool idle = false;
+
+        {
+            std::lock_guard<std::mutex> lock(registry.mutex);
+
+            auto now = std::chrono::steady_clock::now();
+            releaseIdleConnections(registry, now);
+
+            auto it = registry.connections.find(key);
+            if (it != registry.connections.end())
+            {
+                fs   = it->second.fs.lock();
+                idle = (now - it->second.lastUsed >= healthCheckInterval);
+            }
+        }
+
+        // Connections are checked and opened without holding the lock,
+        // so that a slow host does not block opening other paths
+
+        // Check connections that have been idle for a while, the server may have closed them
+        std::shared_ptr<SshFileSystem> stale;
+
+        if (fs && idle && !fs->isConnected())
+        {
+            stale = std::move(fs);
+        }
+
+        // Create new SSH connection
+        if (!fs)
+        {
+            fs = std::make_shared<SshFileSystem>(host, port, user, pass, publicKey, privateKey, credentials);
+
+            // Do not share failed connections
+            if (!fs->isConnected())
+            {
+                return fs->open(localPath);
+            }
         }
 
-        // Create SSH connection
-        std::shared_ptr<SshFileSystem> fs(
-            new SshFileSystem(host, port, user, pass, publicKey, privateKey)
-        );
+        {
+            std::lock_guard<std::mutex> lock(registry.mutex);
+
+            SshConnection & connection = registry.connections[key];
+            std::shared_ptr<SshFileSystem> current = connection.fs.lock();
+
+            // Use the connection that another thread has opened meanwhile, otherwise share this one
+            if (current && current != stale)
+            {
+                fs = current;
+            }
+            else
+            {
+                connection.fs = fs;
+            }
+
+            // Keep connection open until the idle timeout
+            connection.idleRef     = fs;
+            connection.lastUsed    = std::chrono::steady_clock::now();
+            connection.idleTimeout = std::chrono::seconds(idleTime);
+        }
 
         // Open path
         return fs->open(localPath);
@@ -100,6 +266,35 @@ FileHandle open(const std::string & path, const LoginCredentials * credentials)
     }
 }
 
+void releaseConnections()
+{
+#if defined(CPPFS_USE_OpenSSL)
+    SshConnectionRegistry & registry = sshConnections();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    registry.connections.clear();
+#endif
+}
+
+unsigned int pendingRemovals()
+{
+#ifdef SYSTEM_WINDOWS
+    return 0;
+#else
+    return LocalFileHandle::pendingRemovals();
+#endif
+}
+
+bool waitForRemovals(int timeout)
+{
+#ifdef SYSTEM_WINDOWS
+    (void)timeout;
+    return true;
+#else
+    return LocalFileHandle::waitForRemovals(timeout);
+#endif
+}
+
 std::string sha1(const std::string & str)
 {
 #ifdef CPPFS_USE_OpenSSL
@@ -142,11 +337,11 @@ std::string fromBase64(const std::string & base64)
 std::string hashToString(const unsigned char * hash)
 {
     std::stringstream stream;
-    stream << std::hex << std::setfill('0') << std::setw(2);
+    stream << std::hex << std::setfill('0');
 
     for (int i=0; i<20; i++)
     {
-        stream << static_cast<unsigned int>(hash[i]);
+        stream << std::setw(2) << static_cast<unsigned int>(hash[i]);
     }
 
     return stream.str();
@@ -0,0 +1,455 @@
+
+#include <cppfs/linux/FanotifyFileWatcher.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/fanotify.h>
+#include <sys/statfs.h>
+
+#include <cppfs/cppfs.h>
+#include <cppfs/FileHandle.h>
+#include <cppfs/FileWatcher.h>
+#include <cppfs/posix/LocalFileSystem.h>
+
+
+namespace
+{
+
+
+// Convert file handle into a string that can be compared
+std::string fileHandleKey(const struct file_handle * handle)
+{
+    return std::string(reinterpret_cast<const char *>(&handle->handle_type), sizeof(handle->handle_type))
+         + std::string(reinterpret_cast<const char *>(handle->f_handle), handle->handle_bytes);
+}
+
+// Get path of a file inside a directory
+std::string joinPath(const std::string & dir, const std::string & name)
+{
+    if (!dir.empty() && dir.back() == '/') {
+        return dir + name;
+    }
+
+    return dir + "/" + name;
+}
+
+// Get absolute path with all symbolic links resolved
+std::string absolutePath(const std::string & path)
+{
+    char buffer[PATH_MAX];
+
+    if (!realpath(path.c_str(), buffer))
+    {
+        return "";
+    }
+
+    return std::string(buffer);
+}
+
+// Get path relative to a directory, returns false if the path is not located inside the directory
+bool relativePath(const std::string & dir, const std::string & path, std::string & relative)
+{
+    // Determine length of the directory prefix
+    size_t prefix = (dir == "/") ? 1 : dir.size() + 1;
+
+    // Check that path is located inside the directory
+    if (path.size() <= prefix || path.compare(0, dir.size(), dir) != 0 || path[prefix - 1] != '/')
+    {
+        return false;
+    }
+
+    relative = path.substr(prefix);
+    return true;
+}
+
+
+} // namespace
+
+
+namespace cppfs
+{
+
+
+FanotifyFileWatcher::FanotifyFileWatcher(FileWatcher * fileWatcher, std::shared_ptr<LocalFileSystem> fs)
+: LocalFileWatcher(fileWatcher, std::move(fs))
+, m_fanotify(-1)
+, m_epoll(-1)
+{
+#ifdef FAN_REPORT_DFID_NAME
+    // Create fanotify instance (fails on old kernels or without sufficient privileges)
+    m_fanotify = fanotify_init(FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK | FAN_REPORT_DFID_NAME, O_RDONLY | O_LARGEFILE);
+#endif
+
+    // Create epoll instance that waits for both fanotify and inotify events
+    m_epoll = epoll_create1(EPOLL_CLOEXEC);
+
+    for (int fd : { m_fanotify, m_inotify }) {
+        if (m_epoll >= 0 && fd >= 0) {
+            struct epoll_event event;
+            event.events  = EPOLLIN;
+            event.data.fd = fd;
+            epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event);
+        }
+    }
+
+    // Without epoll, fanotify events could not be waited for, so only inotify is used
+    if (m_epoll < 0 && m_fanotify >= 0) {
+        close(m_fanotify);
+        m_fanotify = -1;
+    }
+}
+
+FanotifyFileWatcher::~FanotifyFileWatcher()
+{
+    // Close directories
+    for (auto & mark : m_marks) {
+        close(mark.dirFd);
+    }
+
+    // Close epoll instance
+    if (m_epoll >= 0) {
+        close(m_epoll);
+    }
+
+    // Close fanotify instance (this removes all marks)
+    if (m_fanotify >= 0) {
+        close(m_fanotify);
+    }
+}
+
+void FanotifyFileWatcher::add(FileHandle & dir, unsigned int events, RecursiveMode recursive)
+{
+    // Try to watch directory with fanotify
+    if (m_fanotify >= 0 && addMark(dir, events, recursive)) {
+        return;
+    }
+
+    // Fall back to inotify
+    LocalFileWatcher::add(dir, events, recursive);
+}
+
+void FanotifyFileWatcher::watch(int timeout)
+{
+    // Only inotify is used without epoll
+    if (m_epoll < 0) {
+        LocalFileWatcher::watch(timeout);
+        return;
+    }
+
+    // Wait for fanotify and inotify events
+    struct epoll_event events[2];
+
+    int rv = epoll_wait(m_epoll, events, 2, timeout >= 0 ? timeout : -1);
+    if (rv <= 0) {
+        return;
+    }
+
+    // Process events
+    processPending();
+}
+
+int FanotifyFileWatcher::nativeHandle() const
+{
+    // Only inotify is used without epoll
+    if (m_epoll < 0) {
+        return LocalFileWatcher::nativeHandle();
+    }
+
+    return m_epoll;
+}
+
+void FanotifyFileWatcher::processPending()
+{
+    // Both descriptors are non-blocking, so they can be drained unconditionally
+    if (m_fanotify >= 0) {
+        readFanotifyEvents();
+    }
+
+    readEvents();
+}
+
+bool FanotifyFileWatcher::addMark(FileHandle & dir, unsigned int events, RecursiveMode recursive)
+{
+#ifdef FAN_REPORT_DFID_NAME
+    // Get watch mode
+    uint64_t mask = FAN_ONDIR;
+    if (events & FileCreated)     mask |= FAN_CREATE;
+    if (events & FileRemoved)     mask |= FAN_DELETE;
+    if (events & FileModified)    mask |= FAN_MODIFY;
+    if (events & FileAttrChanged) mask |= FAN_ATTRIB;
+    if (events & FileClosedWrite) mask |= FAN_CLOSE_WRITE;
+
+    // Get rename events (needed to report files moved into or out of the directory as well)
+    uint64_t renameMask = 0;
+    if (events & (FileCreated | FileRemoved | FileMoved)) {
+#ifdef FAN_RENAME
+        renameMask = FAN_RENAME;
+#else
+        // Moves cannot be paired without FAN_RENAME (see below)
+        if (events & FileMoved) return false;
+
+        renameMask = FAN_MOVED_FROM | FAN_MOVED_TO;
+#endif
+    }
+
+    // Get absolute path, as fanotify reports events with resolved paths
+    Mark mark;
+    mark.dir       = dir;
+    mark.path      = absolutePath(dir.path());
+    mark.events    = events;
+    mark.recursive = recursive;
+
+    if (mark.path.empty()) {
+        return false;
+    }
+
+    // Open directory
+    mark.dirFd = open(mark.path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (mark.dirFd < 0) {
+        return false;
+    }
+
+    // Get file system ID
+    struct statfs fsInfo;
+    if (fstatfs(mark.dirFd, &fsInfo) != 0) {
+        close(mark.dirFd);
+        return false;
+    }
+
+    mark.fsid.assign(reinterpret_cast<const char *>(&fsInfo.f_fsid), sizeof(fsInfo.f_fsid));
+
+    // Get file handle of the directory (fails if the file system does not support file handles)
+    std::vector<char> buffer(sizeof(struct file_handle) + MAX_HANDLE_SZ);
+    auto * handle = reinterpret_cast<struct file_handle *>(buffer.data());
+    handle->handle_bytes = MAX_HANDLE_SZ;
+
+    int mountId = 0;
+    if (name_to_handle_at(mark.dirFd, "", handle, &mountId, AT_EMPTY_PATH) != 0) {
+        close(mark.dirFd);
+        return false;
+    }
+
+    mark.handle = fileHandleKey(handle);
+
+    // Watch entire file system for recursive watches, otherwise only the directory itself
+    unsigned int flags = FAN_MARK_ADD;
+    if (recursive == Recursive) flags |= FAN_MARK_FILESYSTEM;
+    else                        mask  |= FAN_EVENT_ON_CHILD;
+
+    if (fanotify_mark(m_fanotify, flags, mask | renameMask, mark.dirFd, nullptr) != 0) {
+        // Kernels older than 5.17 do not support FAN_RENAME. FAN_MOVED_FROM and FAN_MOVED_TO
+        // carry no cookie to pair them, so moves can only be reported as separate events.
+        // If FileMoved is watched, let inotify watch the directory instead.
+        if (errno != EINVAL || !renameMask || (events & FileMoved) ||
+            fanotify_mark(m_fanotify, flags, mask | FAN_MOVED_FROM | FAN_MOVED_TO, mark.dirFd, nullptr) != 0)
+        {
+            close(mark.dirFd);
+            return false;
+        }
+    }
+
+    // Add directory to list
+    m_marks.push_back(std::move(mark));
+    return true;
+#else
+    (void)dir;
+    (void)events;
+    (void)recursive;
+
+    return false;
+#endif
+}
+
+void FanotifyFileWatcher::readFanotifyEvents()
+{
+    // Create buffer for receiving events
+    std::vector<char> buffer(64 * 1024);
+
+    // Read until no more events are available
+    while (true) {
+        ssize_t size = read(m_fanotify, buffer.data(), buffer.size());
+        if (size <= 0) {
+            return;
+        }
+
+        // Process all events
+        auto * metadata = reinterpret_cast<struct fanotify_event_metadata *>(buffer.data());
+        while (FAN_EVENT_OK(metadata, size)) {
+            // Ignore events of different versions and queue overflows
+            if (metadata->vers == FANOTIFY_METADATA_VERSION && !(metadata->mask & FAN_Q_OVERFLOW)) {
+                processFanotifyEvent(metadata);
+            }
+
+            // Next event
+            metadata = FAN_EVENT_NEXT(metadata, size);
+        }
+    }
+}
+
+void FanotifyFileWatcher::processFanotifyEvent(const void * data)
+{
+#ifdef FAN_REPORT_DFID_NAME
+    auto * metadata = reinterpret_cast<const struct fanotify_event_metadata *>(data);
+
+    // Find information records containing directory and file name
+    const void * info    = nullptr;
+    const void * oldInfo = nullptr;
+    const void * newInfo = nullptr;
+
+    const char * record = reinterpret_cast<const char *>(metadata) + metadata->metadata_len;
+    const char * end    = reinterpret_cast<const char *>(metadata) + metadata->event_len;
+    while (record + sizeof(struct fanotify_event_info_header) <= end) {
+        auto * header = reinterpret_cast<const struct fanotify_event_info_header *>(record);
+        if (header->len == 0) {
+            break;
+        }
+
+        if (header->info_type == FAN_EVENT_INFO_TYPE_DFID_NAME) info = record;
+#ifdef FAN_RENAME
+        if (header->info_type == FAN_EVENT_INFO_TYPE_OLD_DFID_NAME) oldInfo = record;
+        if (header->info_type == FAN_EVENT_INFO_TYPE_NEW_DFID_NAME) newInfo = record;
+#endif
+
+        record += header->len;
+    }
+
+    // Process rename
+    if (oldInfo || newInfo) {
+        // Find watched directories that contain the source and the destination
+        std::string fsid, path, relFrom, relTo;
+        const Mark * from = (oldInfo && resolvePath(oldInfo, fsid, path)) ? findMark(fsid, path, relFrom) : nullptr;
+        const Mark * to   = (newInfo && resolvePath(newInfo, fsid, path)) ? findMark(fsid, path, relTo)   : nullptr;
+
+        // Invoke callback functions
+        bool isDirectory = (metadata->mask & FAN_ONDIR) != 0;
+
+        if (from && to && (to->events & FileMoved)) {
+            onFileMoved(joinPath(from->dir.path(), relFrom), joinPath(to->dir.path(), relTo), isDirectory, 0, static_cast<unsigned int>(metadata->mask));
+        } else {
+            if (from && (from->events & FileRemoved)) {
+                onFileEvent(joinPath(from->dir.path(), relFrom), FileRemoved, isDirectory, 0, static_cast<unsigned int>(metadata->mask));
+            }
+
+            if (to && (to->events & FileCreated)) {
+                onFileEvent(joinPath(to->dir.path(), relTo), FileCreated, isDirectory, 0, static_cast<unsigned int>(metadata->mask));
+            }
+        }
+    }
+
+    // Resolve file
+    std::string fsid, path, relative;
+    const Mark * mark = (info && resolvePath(info, fsid, path)) ? findMark(fsid, path, relative) : nullptr;
+    if (!mark) {
+        return;
+    }
+
+    // Report events
+    const std::pair<uint64_t, FileEvent> eventTypes[] = {
+        { FAN_CREATE,      FileCreated     },
+        { FAN_MOVED_TO,    FileCreated     },
+        { FAN_MODIFY,      FileModified    },
+        { FAN_ATTRIB,      FileAttrChanged },
+        { FAN_DELETE,      FileRemoved     },
+        { FAN_MOVED_FROM,  FileRemoved     },
+        { FAN_CLOSE_WRITE, FileClosedWrite }
+    };
+
+    bool isDirectory = (metadata->mask & FAN_ONDIR) != 0;
+
+    for (auto & eventType : eventTypes) {
+        if ((metadata->mask & eventType.first) && (mark->events & eventType.second)) {
+            // Invoke callback function
+            onFileEvent(joinPath(mark->dir.path(), relative), eventType.second, isDirectory, 0, static_cast<unsigned int>(metadata->mask));
+        }
+    }
+#else
+    (void)data;
+#endif
+}
+
+bool FanotifyFileWatcher::resolvePath(const void * data, std::string & fsid, std::string & path) const
+{
+#ifdef FAN_REPORT_DFID_NAME
+    auto * info = reinterpret_cast<const struct fanotify_event_info_fid *>(data);
+
+    // Get file handle of the directory and file name
+    auto * handle = reinterpret_cast<struct file_handle *>(const_cast<unsigned char *>(info->handle));
+    std::string name(reinterpret_cast<const char *>(handle->f_handle + handle->handle_bytes));
+    std::string key = fileHandleKey(handle);
+    fsid.assign(reinterpret_cast<const char *>(&info->fsid), sizeof(info->fsid));
+
+    // Resolve directory, which is cheap if it is one of the watched directories
+    std::string dirPath;
+    const Mark * fsMark = nullptr;
+    for (auto & mark : m_marks) {
+        if (mark.fsid != fsid) continue;
+
+        if (mark.handle == key) {
+            dirPath = mark.path;
+            break;
+        }
+
+        if (!fsMark) fsMark = &mark;
+    }
+
+    if (dirPath.empty() && fsMark) {
+        // Open directory by its file handle and query its path
+        int fd = open_by_handle_at(fsMark->dirFd, handle, O_PATH | O_CLOEXEC);
+        if (fd >= 0) {
+            char buffer[PATH_MAX];
+            ssize_t len = readlink(("/proc/self/fd/" + std::to_string(fd)).c_str(), buffer, sizeof(buffer));
+            close(fd);
+
+            if (len > 0) {
+                dirPath.assign(buffer, len);
+            }
+        }
+    }
+
+    // Ignore events in directories that are gone
+    const std::string deleted = " (deleted)";
+    if (dirPath.empty() || dirPath[0] != '/' ||
+        (dirPath.size() > deleted.size() && dirPath.compare(dirPath.size() - deleted.size(), deleted.size(), deleted) == 0))
+    {
+        return false;
+    }
+
+    // Compose path
+    path = dirPath;
+    if (!name.empty() && name != ".") {
+        path = (dirPath == "/") ? "/" + name : dirPath + "/" + name;
+    }
+
+    return true;
+#else
+    (void)data;
+    (void)fsid;
+    (void)path;
+
+    return false;
+#endif
+}
+
+const FanotifyFileWatcher::Mark * FanotifyFileWatcher::findMark(const std::string & fsid, const std::string & path, std::string & relative) const
+{
+    for (auto & mark : m_marks) {
+        if (mark.fsid != fsid) continue;
+
+        // Get path relative to the watched directory
+        if (!relativePath(mark.path, path, relative)) continue;
+
+        // Non-recursive watches only report direct children
+        if (mark.recursive == NonRecursive && relative.find('/') != std::string::npos) continue;
+
+        return &mark;
+    }
+
+    return nullptr;
+}
+
+
+} // namespace cppfs
@@ -3,8 +3,8 @@
 
 #include <unistd.h>
 #include <limits.h>
+#include <poll.h>
 #include <sys/inotify.h>
-#include <sys/select.h>
 
 #include <cppfs/cppfs.h>
 #include <cppfs/FilePath.h>
@@ -15,6 +15,31 @@
 #include <cppfs/posix/LocalFileIterator.h>
 
 
+namespace
+{
+
+
+// Get path of a file inside a directory
+std::string joinPath(const std::string & dir, const char * name)
+{
+    if (!dir.empty() && dir.back() == '/') {
+        return dir + name;
+    }
+
+    return dir + "/" + name;
+}
+
+// Check if a path is equal to or located inside a directory
+bool isInside(const std::string & dir, const std::string & path)
+{
+    return path.compare(0, dir.size(), dir) == 0 &&
+           (path.size() == dir.size() || path[dir.size()] == '/');
+}
+
+
+} // namespace
+
+
 namespace cppfs
 {
 
@@ -24,8 +49,8 @@ LocalFileWatcher::LocalFileWatcher(FileWatcher * fileWatcher, std::shared_ptr<Lo
 , m_fs(std::move(fs))
 , m_inotify(-1)
 {
-    // Create inotify instance
-    m_inotify = inotify_init();
+    // Create inotify instance (non-blocking, so pending events can be drained)
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
 }
 
 LocalFileWatcher::~LocalFileWatcher()
@@ -53,7 +78,10 @@ void LocalFileWatcher::add(FileHandle & dir, unsigned int events, RecursiveMode
     if (events & FileRemoved)     flags |= IN_DELETE;
     if (events & FileModified)    flags |= IN_MODIFY;
     if (events & FileAttrChanged) flags |= IN_ATTRIB;
+    if (events & FileClosedWrite) flags |= IN_CLOSE_WRITE;
 
+    // Always watch renames, as they are needed to keep track of watched directories
+    flags |= IN_MOVED_FROM | IN_MOVED_TO;
 
     // Create watcher
     int handle = inotify_add_watch(m_inotify, dir.path().c_str(), flags);
@@ -82,67 +110,202 @@ void LocalFileWatcher::add(FileHandle & dir, unsigned int events, RecursiveMode
 }
 
 void LocalFileWatcher::watch(int timeout)
+{
+    // Wait for events
+    struct pollfd fd;
+    fd.fd      = m_inotify;
+    fd.events  = POLLIN;
+    fd.revents = 0;
+
+    int rv = poll(&fd, 1, timeout >= 0 ? timeout : -1);
+    if (rv <= 0) {
+        return;
+    }
+
+    // Read and process events
+    readEvents();
+}
+
+int LocalFileWatcher::nativeHandle() const
+{
+    return m_inotify;
+}
+
+unsigned int LocalFileWatcher::supportedEvents() const
+{
+    return FileCreated | FileRemoved | FileModified | FileAttrChanged | FileMoved | FileClosedWrite;
+}
+
+void LocalFileWatcher::processPending()
+{
+    readEvents();
+}
+
+void LocalFileWatcher::readEvents()
 {
     // Create buffer for receiving events
     size_t bufSize = 64 * (sizeof(inotify_event) + NAME_MAX);
     std::vector<char> buffer;
     buffer.resize(bufSize);
 
-    // Set timeout
-    if (timeout >= 0) {
-        // Create file descriptor set
-        fd_set set;
-        FD_ZERO(&set);
-        FD_SET(m_inotify, &set);
-
-        // Convert timeout into timeval struct
-        struct timeval tval;
-        tval.tv_sec = timeout / 1000;
-        tval.tv_usec = (timeout - tval.tv_sec * 1000) * 1000;
-
-        // Set timeout on file descriptor
-        int rv = select(m_inotify + 1, &set, NULL, NULL, &tval);
-        if (rv <= 0) {
-            return;
+    // Source of renames that have not yet been paired with their destination
+    struct Move {
+        std::string  path;
+        unsigned int events;
+        uint32_t     mask;
+        bool         isDirectory;
+    };
+
+    std::map<uint32_t, Move> moves;
+
+    // Read until no more events are available
+    while (true) {
+        ssize_t size = read(m_inotify, buffer.data(), bufSize);
+        if (size <= 0) {
+            break;
         }
-    }
 
-    // Read events
-    int size = read(m_inotify, buffer.data(), bufSize);
-    if (size < 0) {
-        return;
-    }
+        // Process all events
+        ssize_t i = 0;
+        while (i < size) {
+            // Get event
+            auto * event = reinterpret_cast<inotify_event *>(&buffer.data()[i]);
+
+            // Next event
+            i += sizeof(inotify_event) + event->len;
+
+            // Get watcher
+            auto it = m_watchers.find(event->wd);
+            if (it == m_watchers.end()) {
+                continue;
+            }
+
+            // Forget watchers that have been removed
+            if (event->mask & IN_IGNORED) {
+                m_watchers.erase(it);
+                continue;
+            }
+
+            // Ignore events on the watched directory itself
+            if (!event->len) {
+                continue;
+            }
+
+            // Get watcher (references into the map stay valid while watchers are added)
+            const Watcher & watcher = it->second;
+
+            // Get path
+            std::string path = joinPath(watcher.dir.path(), event->name);
+            bool isDirectory = (event->mask & IN_ISDIR) != 0;
+
+            // Remember source of rename until its destination arrives
+            if (event->mask & IN_MOVED_FROM) {
+                Move & move = moves[event->cookie];
+                move.path        = std::move(path);
+                move.events      = watcher.events;
+                move.mask        = event->mask;
+                move.isDirectory = isDirectory;
+                continue;
+            }
+
+            // Pair destination of rename with its source
+            if (event->mask & IN_MOVED_TO) {
+                auto move = moves.find(event->cookie);
+
+                if (move != moves.end()) {
+                    // Update or create watchers for renamed directories
+                    bool watched = isDirectory && renameWatchers(move->second.path, path);
+                    if (isDirectory && !watched && watcher.recursive == Recursive) {
+                        FileHandle dir = m_fs->open(path);
+                        add(dir, watcher.events, watcher.recursive);
+                    }
+
+                    // Invoke callback functions
+                    if (watcher.events & FileMoved) {
+                        onFileMoved(move->second.path, path, isDirectory, event->cookie, event->mask);
+                    } else {
+                        if (move->second.events & FileRemoved) onFileEvent(move->second.path, FileRemoved, isDirectory, event->cookie, move->second.mask);
+                        if (watcher.events & FileCreated)      onFileEvent(path, FileCreated, isDirectory, event->cookie, event->mask);
+                    }
+
+                    moves.erase(move);
+                } else {
+                    // File has been moved into a watched directory
+                    if (isDirectory && watcher.recursive == Recursive) {
+                        FileHandle dir = m_fs->open(path);
+                        add(dir, watcher.events, watcher.recursive);
+                    }
+
+                    if (watcher.events & FileCreated) {
+                        onFileEvent(path, FileCreated, isDirectory, event->cookie, event->mask);
+                    }
+                }
+
+                continue;
+            }
 
-    // Process all events
-    int i = 0;
-    while (i < size) {
-        // Get event
-        auto * event = reinterpret_cast<inotify_event *>(&buffer.data()[i]);
-        if (event->len) {
             // Get event
             FileEvent eventType = (FileEvent)0;
                  if (event->mask & IN_CREATE) eventType = FileCreated;
             else if (event->mask & IN_DELETE) eventType = FileRemoved;
             else if (event->mask & IN_MODIFY) eventType = FileModified;
             else if (event->mask & IN_ATTRIB) eventType = FileAttrChanged;
-
-            // Get watcher
-            auto & watcher = m_watchers[event->wd];
-
-            // Get file handle
-            FileHandle fh = (event->len > 0 ? watcher.dir.open(std::string(event->name)) : watcher.dir);
+            else if (event->mask & IN_CLOSE_WRITE) eventType = FileClosedWrite;
 
             // Watch new directories
-            if (fh.isDirectory() && eventType == FileCreated && watcher.recursive == Recursive) {
-                add(fh, watcher.events, watcher.recursive);
+            if (isDirectory && eventType == FileCreated && watcher.recursive == Recursive) {
+                FileHandle dir = m_fs->open(path);
+                add(dir, watcher.events, watcher.recursive);
             }
 
             // Invoke callback function
-            onFileEvent(fh, eventType);
+            onFileEvent(std::move(path), eventType, isDirectory, 0, event->mask);
+        }
+    }
+
+    // Files without destination have been moved out of the watched directories
+    for (auto & it : moves) {
+        Move & move = it.second;
+
+        if (move.isDirectory) {
+            removeWatchers(move.path);
         }
 
-        // Next event
-        i += sizeof(inotify_event) + event->len;
+        if (move.events & FileRemoved) {
+            onFileEvent(move.path, FileRemoved, move.isDirectory, it.first, move.mask);
+        }
+    }
+}
+
+bool LocalFileWatcher::renameWatchers(const std::string & from, const std::string & to)
+{
+    bool found = false;
+
+    for (auto & it : m_watchers) {
+        // Check if watched directory is located inside the renamed directory
+        std::string path = it.second.dir.path();
+        if (!isInside(from, path)) {
+            continue;
+        }
+
+        // Update path
+        it.second.dir = m_fs->open(to + path.substr(from.size()));
+        found = true;
+    }
+
+    return found;
+}
+
+void LocalFileWatcher::removeWatchers(const std::string & path)
+{
+    for (auto it = m_watchers.begin(); it != m_watchers.end(); ) {
+        // Check if watched directory is located inside the directory
+        if (isInside(path, it->second.dir.path())) {
+            inotify_rm_watch(m_inotify, it->first);
+            it = m_watchers.erase(it);
+        } else {
+            ++it;
+        }
     }
 }
 
@@ -2,16 +2,1025 @@
 #include <cppfs/posix/LocalFileHandle.h>
 
 #include <fstream>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <memory>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <chrono>
 #include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#ifdef __linux__
+    #include <sys/ioctl.h>
+    #include <linux/fs.h>
+#endif
+
 #include <cppfs/cppfs.h>
 #include <cppfs/FilePath.h>
+#include <cppfs/CopyOptions.h>
 #include <cppfs/posix/LocalFileSystem.h>
 #include <cppfs/posix/LocalFileIterator.h>
 
+#if defined(__linux__) && defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+    #define CPPFS_HAS_COPY_FILE_RANGE
+#endif
+
+
+namespace
+{
+
+
+// Size of the buffer used when data has to be copied through user space
+const size_t copyBufferSize = 1024 * 1024;
+
+// Copy range of a file (stops early at the end of the source file)
+bool copyRange(int in, int out, off_t offset, off_t length)
+{
+#ifdef CPPFS_HAS_COPY_FILE_RANGE
+    // Let the kernel copy the data (this also allows file systems to share extents)
+    off_t inOffset  = offset;
+    off_t outOffset = offset;
+
+    while (length > 0)
+    {
+        ssize_t count = copy_file_range(in, &inOffset, out, &outOffset, static_cast<size_t>(length), 0);
+
+        if (count > 0)
+        {
+            length -= count;
+            continue;
+        }
+
+        if (count == 0) return true;
+        if (errno == EINTR) continue;
+
+        // Fall back to read/write if not supported for these files
+        if (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP) break;
+
+        return false;
+    }
+
+    if (length == 0) return true;
+    offset = inOffset;
+#endif
+
+    // Copy data through user space
+    std::vector<char> buffer(static_cast<size_t>(std::min<off_t>(length, copyBufferSize)));
+
+    while (length > 0)
+    {
+        ssize_t count = pread(in, buffer.data(), static_cast<size_t>(std::min<off_t>(length, buffer.size())), offset);
+
+        if (count == 0) return true;
+        if (count < 0)
+        {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        for (ssize_t written = 0; written < count; )
+        {
+            ssize_t res = pwrite(out, buffer.data() + written, static_cast<size_t>(count - written), offset + written);
+
+            if (res < 0)
+            {
+                if (errno == EINTR) continue;
+                return false;
+            }
+
+            written += res;
+        }
+
+        offset += count;
+        length -= count;
+    }
+
+    return true;
+}
+
+// Copy the data regions within a range of a file, so that holes stay holes in the destination
+bool copyData(int in, int out, off_t begin, off_t end)
+{
+#ifdef SEEK_DATA
+    off_t pos = begin;
+
+    while (pos < end)
+    {
+        // Find next data region (the file offset is not used by copyRange, so threads can share the descriptor)
+        off_t data = lseek(in, pos, SEEK_DATA);
+
+        if (data < 0)
+        {
+            // No more data
+            if (errno == ENXIO) return true;
+
+            // Holes cannot be detected, copy everything
+            return copyRange(in, out, pos, end - pos);
+        }
+
+        if (data >= end) return true;
+
+        off_t hole = lseek(in, data, SEEK_HOLE);
+        if (hole < 0 || hole > end) hole = end;
+
+        // Copy data region
+        if (!copyRange(in, out, data, hole - data)) return false;
+
+        pos = hole;
+    }
+
+    return true;
+#else
+    return copyRange(in, out, begin, end - begin);
+#endif
+}
+
+// Share the data of a file with another file on copy-on-write file systems (returns 'false' if not supported)
+bool cloneFile(int in, int out)
+{
+#ifdef FICLONE
+    return ioctl(out, FICLONE, in) == 0;
+#else
+    (void)in;
+    (void)out;
+    errno = EOPNOTSUPP;
+    return false;
+#endif
+}
+
+// Set size of a file and optionally allocate disk space for it
+void setFileSize(int fd, off_t size, bool allocate)
+{
+#ifdef __linux__
+    // Not supported by all file systems, the size is set below anyway
+    if (allocate)
+    {
+        fallocate(fd, 0, 0, size);
+    }
+#else
+    (void)allocate;
+#endif
+
+    if (ftruncate(fd, size) != 0)
+    {
+        // Ranges are written nevertheless, which extends the file
+    }
+}
+
+// Get access and modification time of a file
+void fileTimes(const struct stat & info, struct timespec times[2])
+{
+#ifdef __APPLE__
+    times[0] = info.st_atimespec;
+    times[1] = info.st_mtimespec;
+#else
+    times[0] = info.st_atim;
+    times[1] = info.st_mtim;
+#endif
+}
+
+// Copy of a directory tree on several threads
+class TreeCopy
+{
+public:
+    TreeCopy(const cppfs::CopyOptions & options, bool clone = false)
+    : m_options(options)
+    , m_clone(clone)
+    , m_active(0)
+    , m_failed(false)
+    , m_clonedBytes(0)
+    , m_copiedBytes(0)
+    {
+    }
+
+    // Get number of bytes that have been cloned
+    unsigned long long clonedBytes() const
+    {
+        return m_clonedBytes;
+    }
+
+    // Get number of bytes that have been copied
+    unsigned long long copiedBytes() const
+    {
+        return m_copiedBytes;
+    }
+
+    // Copy directory tree (returns 'false' if any entry could not be copied)
+    bool run(const std::string & src, const std::string & dst)
+    {
+        // Check directories
+        struct stat info;
+        if (stat(src.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) return false;
+        if (mkdir(dst.c_str(), directoryMode()) != 0 && errno != EEXIST) return false;
+
+        addDirectory(Task{ src, dst, info });
+
+        // Copy on worker threads and this thread
+        std::vector<std::thread> workers;
+        for (unsigned int i = 1; i < m_options.workers(); i++)
+        {
+            workers.emplace_back(&TreeCopy::work, this);
+        }
+
+        work();
+
+        for (auto & worker : workers)
+        {
+            worker.join();
+        }
+
+        // Apply metadata of directories after their contents have been copied, because
+        // adding entries changes their modification time (subdirectories first, so that
+        // restrictive permissions of a directory do not prevent access to its contents)
+        for (auto it = m_dirs.rbegin(); it != m_dirs.rend(); ++it)
+        {
+            const Task & dir = *it;
+
+            if (chown(dir.dst.c_str(), dir.info.st_uid, dir.info.st_gid) != 0)
+            {
+                // Owner can only be changed by privileged users
+            }
+
+            struct timespec times[2];
+            fileTimes(dir.info, times);
+
+            if (chmod(dir.dst.c_str(), dir.info.st_mode & 07777) != 0 ||
+                utimensat(AT_FDCWD, dir.dst.c_str(), times, 0) != 0)
+            {
+                m_failed = true;
+            }
+        }
+
+        return !m_failed;
+    }
+
+
+protected:
+    // Directory or file to copy
+    struct Task
+    {
+        std::string src;  ///< Source path
+        std::string dst;  ///< Destination path
+        struct stat info; ///< Attributes of the source
+    };
+
+
+protected:
+    // Get mode for new directories (writable until their metadata is applied)
+    mode_t directoryMode() const
+    {
+        return m_options.preserveMetadata() ? 0700 : 0755;
+    }
+
+    // Add directory to the queue
+    void addDirectory(Task && task)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_options.preserveMetadata())
+        {
+            m_dirs.push_back(task);
+        }
+
+        m_queue.push_back(std::move(task));
+    }
+
+    // Process tasks until all directories have been listed and all files have been copied
+    void work()
+    {
+        while (true)
+        {
+            // Get next task, stop when the queue is empty and no other thread can add tasks
+            Task task;
+
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this] { return !m_queue.empty() || m_active == 0; });
+                if (m_queue.empty()) break;
+
+                // Take the newest task, so that the walk proceeds depth-first and the queue stays short
+                task = std::move(m_queue.back());
+                m_queue.pop_back();
+                m_active++;
+            }
+
+            // Process task
+            if (S_ISDIR(task.info.st_mode))
+            {
+                copyDirectory(task);
+            }
+            else
+            {
+                copyFile(task);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_active--;
+            }
+
+            m_condition.notify_all();
+        }
+
+        m_condition.notify_all();
+    }
+
+    // Create subdirectories and queue the entries of a directory
+    void copyDirectory(const Task & task)
+    {
+        DIR * dir = opendir(task.src.c_str());
+        if (!dir)
+        {
+            m_failed = true;
+            return;
+        }
+
+        std::vector<Task> files;
+        std::vector<Task> subdirs;
+
+        while (struct dirent * entry = readdir(dir))
+        {
+            std::string name = entry->d_name;
+            if (name == "." || name == "..") continue;
+
+            Task child{ task.src + "/" + name, task.dst + "/" + name, {} };
+
+            // Get attributes (one call per entry)
+            if (fstatat(dirfd(dir), entry->d_name, &child.info, AT_SYMLINK_NOFOLLOW) != 0)
+            {
+                m_failed = true;
+                continue;
+            }
+
+            if (S_ISLNK(child.info.st_mode))
+            {
+                // Re-create symbolic link
+                if (m_options.preserveLinks())
+                {
+                    copySymbolicLink(dirfd(dir), entry->d_name, child);
+                    continue;
+                }
+
+                // Or follow it, like the generic implementation (broken links are skipped)
+                if (fstatat(dirfd(dir), entry->d_name, &child.info, 0) != 0) continue;
+            }
+
+            if (S_ISDIR(child.info.st_mode))
+            {
+                if (mkdir(child.dst.c_str(), directoryMode()) != 0 && errno != EEXIST)
+                {
+                    m_failed = true;
+                    continue;
+                }
+
+                subdirs.push_back(std::move(child));
+            }
+
+            else if (S_ISREG(child.info.st_mode))
+            {
+                files.push_back(std::move(child));
+            }
+        }
+
+        closedir(dir);
+
+        // Queue entries
+        for (auto & subdir : subdirs)
+        {
+            addDirectory(std::move(subdir));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            for (auto & file : files)
+            {
+                m_queue.push_back(std::move(file));
+            }
+        }
+
+        m_condition.notify_all();
+    }
+
+    // Copy file or re-create hard link
+    void copyFile(const Task & task)
+    {
+        const struct stat & info = task.info;
+
+        int    flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+        mode_t mode  = m_options.preserveMetadata() ? 0600 : 0666;
+        int    out   = -1;
+
+        if (m_options.preserveLinks() && info.st_nlink > 1)
+        {
+            std::lock_guard<std::mutex> lock(m_linksMutex);
+
+            // Link to the copy of a file that has already been found under another name
+            auto key = std::make_pair(info.st_dev, info.st_ino);
+            auto it  = m_links.find(key);
+
+            if (it != m_links.end())
+            {
+                unlink(task.dst.c_str());
+
+                if (link(it->second.c_str(), task.dst.c_str()) != 0)
+                {
+                    m_failed = true;
+                }
+
+                return;
+            }
+
+            // Create the copy while the map is locked, so that other names can be linked to it right away
+            out = open(task.dst.c_str(), flags, mode);
+            if (out < 0)
+            {
+                m_failed = true;
+                return;
+            }
+
+            m_links[key] = task.dst;
+        }
+        else
+        {
+            out = open(task.dst.c_str(), flags, mode);
+            if (out < 0)
+            {
+                m_failed = true;
+                return;
+            }
+        }
+
+        // Clone or copy data
+        bool result = false;
+        int  in     = open(task.src.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (in >= 0)
+        {
+            // Stop trying to clone once the file system has refused it
+            if (m_clone && cloneFile(in, out))
+            {
+                m_clonedBytes += info.st_size;
+                result = true;
+            }
+            else
+            {
+                if (m_clone && (errno == EOPNOTSUPP || errno == ENOTTY || errno == EXDEV || errno == EINVAL || errno == ENOSYS))
+                {
+                    m_clone = false;
+                }
+
+                // The size is set first, so a copy that stops early still has it (the result is what counts)
+                setFileSize(out, info.st_size, false);
+
+                if (copyData(in, out, 0, info.st_size))
+                {
+                    m_copiedBytes += info.st_size;
+                    result = true;
+                }
+            }
+
+            close(in);
+        }
+
+        // Apply metadata (the owner first, because changing it clears setuid bits)
+        if (result && m_options.preserveMetadata())
+        {
+            if (fchown(out, info.st_uid, info.st_gid) != 0)
+            {
+                // Owner can only be changed by privileged users
+            }
+
+            struct timespec times[2];
+            fileTimes(info, times);
+
+            result = fchmod(out, info.st_mode & 07777) == 0 && futimens(out, times) == 0;
+        }
+
+        // Data that has not been written yet can still fail on close (e.g., on network file systems)
+        if (close(out) != 0 || !result)
+        {
+            m_failed = true;
+        }
+    }
+
+    // Re-create symbolic link
+    void copySymbolicLink(int dir, const char * name, const Task & task)
+    {
+        // Read link target
+        std::vector<char> target(static_cast<size_t>(std::max<off_t>(task.info.st_size, 255)) + 1);
+
+        ssize_t size = readlinkat(dir, name, target.data(), target.size() - 1);
+        if (size < 0)
+        {
+            m_failed = true;
+            return;
+        }
+
+        target[static_cast<size_t>(size)] = '\0';
+
+        // Create link
+        unlink(task.dst.c_str());
+        if (symlink(target.data(), task.dst.c_str()) != 0)
+        {
+            m_failed = true;
+            return;
+        }
+
+        // Apply metadata
+        if (m_options.preserveMetadata())
+        {
+            if (fchownat(AT_FDCWD, task.dst.c_str(), task.info.st_uid, task.info.st_gid, AT_SYMLINK_NOFOLLOW) != 0)
+            {
+                // Owner can only be changed by privileged users
+            }
+
+            struct timespec times[2];
+            fileTimes(task.info, times);
+
+            if (utimensat(AT_FDCWD, task.dst.c_str(), times, AT_SYMLINK_NOFOLLOW) != 0)
+            {
+                m_failed = true;
+            }
+        }
+    }
+
+
+protected:
+    const cppfs::CopyOptions &                     m_options;     ///< Copy options
+    std::atomic<bool>                              m_clone;       ///< Clone files instead of copying them?
+    std::deque<Task>                               m_queue;       ///< Directories to list and files to copy
+    std::vector<Task>                              m_dirs;        ///< Copied directories (for applying their metadata)
+    unsigned int                                   m_active;      ///< Number of tasks that are being processed
+    std::atomic<bool>                              m_failed;      ///< Has any entry not been copied?
+    std::mutex                                     m_mutex;       ///< Protects the queue
+    std::condition_variable                        m_condition;   ///< Signals new tasks and finished tasks
+    std::map<std::pair<dev_t, ino_t>, std::string> m_links;       ///< Copied files with several links (device and inode -> destination path)
+    std::mutex                                     m_linksMutex;  ///< Protects the link map
+    std::atomic<unsigned long long>                m_clonedBytes; ///< Number of bytes that have been cloned
+    std::atomic<unsigned long long>                m_copiedBytes; ///< Number of bytes that have been copied
+};
+
+// Removal of a directory tree on several threads
+class TreeRemoval
+{
+public:
+    TreeRemoval(unsigned int workers, const std::atomic<bool> * cancel = nullptr)
+    : m_workers(std::max(workers, 1u))
+    , m_active(0)
+    , m_cancel(cancel)
+    {
+    }
+
+    ~TreeRemoval()
+    {
+        // Close directories that have not been finished, because the removal has been cancelled
+        for (auto & dir : m_dirs)
+        {
+            if (dir->fd >= 0) close(dir->fd);
+        }
+    }
+
+    // Remove directory tree (returns 'true' if the directory is gone)
+    bool run(const std::string & path)
+    {
+        // Check directory
+        struct stat info;
+        if (lstat(path.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) return false;
+
+        m_queue.push_back(addDirectory(std::string(path), nullptr));
+
+        // Remove on worker threads and this thread
+        std::vector<std::thread> workers;
+        for (unsigned int i = 1; i < m_workers; i++)
+        {
+            workers.emplace_back(&TreeRemoval::work, this);
+        }
+
+        work();
+
+        for (auto & worker : workers)
+        {
+            worker.join();
+        }
+
+        return lstat(path.c_str(), &info) != 0 && errno == ENOENT;
+    }
+
+
+protected:
+    // Directory to remove
+    struct Directory
+    {
+        Directory(std::string && name, Directory * parent)
+        : name(std::move(name))
+        , parent(parent)
+        , fd(-1)
+        , pending(1)
+        {
+        }
+
+        std::string               name;    ///< Name of the directory within its parent (path for the root)
+        Directory               * parent;  ///< Parent directory (null for the root)
+        int                       fd;      ///< File descriptor of the directory (open until the directory is removed, -1 if not open)
+        std::atomic<unsigned int> pending; ///< Number of subdirectories that still exist (plus one while the directory is being listed)
+    };
+
+
+protected:
+    // Create directory entry
+    Directory * addDirectory(std::string && name, Directory * parent)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_dirs.emplace_back(new Directory(std::move(name), parent));
+        return m_dirs.back().get();
+    }
+
+    // Process directories until the tree has been removed
+    void work()
+    {
+        while (true)
+        {
+            // Get next directory, stop when the queue is empty and no other thread can add directories
+            Directory * dir = nullptr;
+
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this] { return !m_queue.empty() || m_active == 0; });
+                if (m_queue.empty() || (m_cancel && *m_cancel)) break;
+
+                // Take the newest directory, so that the walk proceeds depth-first and the queue stays short
+                dir = m_queue.back();
+                m_queue.pop_back();
+                m_active++;
+            }
+
+            removeEntries(dir);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_active--;
+            }
+
+            m_condition.notify_all();
+        }
+
+        m_condition.notify_all();
+    }
+
+    // Remove the files of a directory and queue its subdirectories
+    void removeEntries(Directory * dir)
+    {
+        std::vector<Directory *> subdirs;
+
+        // Open directory relative to its parent without following a link that may have replaced it
+        int flags = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+        dir->fd = dir->parent ? openat(dir->parent->fd, dir->name.c_str(), flags) : open(dir->name.c_str(), flags);
+
+        // List it on a duplicate, the descriptor itself is kept for removing the entries
+        int listFd   = (dir->fd >= 0) ? fcntl(dir->fd, F_DUPFD_CLOEXEC, 0) : -1;
+        DIR * handle = (listFd >= 0) ? fdopendir(listFd) : nullptr;
+        int fd       = dir->fd;
+
+        if (handle)
+        {
+            while (struct dirent * entry = readdir(handle))
+            {
+                std::string name = entry->d_name;
+                if (name == "." || name == "..") continue;
+
+                // Get type from the directory entry (only some file systems need a call to stat)
+                bool isDirectory = (entry->d_type == DT_DIR);
+
+                if (entry->d_type == DT_UNKNOWN)
+                {
+                    struct stat info;
+                    if (fstatat(fd, entry->d_name, &info, AT_SYMLINK_NOFOLLOW) != 0) continue;
+
+                    isDirectory = S_ISDIR(info.st_mode);
+                }
+
+                // Remove files and links relative to the directory
+                if (!isDirectory)
+                {
+                    unlinkat(fd, entry->d_name, 0);
+                    continue;
+                }
+
+                subdirs.push_back(addDirectory(std::move(name), dir));
+            }
+
+            closedir(handle);
+        }
+        else if (listFd >= 0)
+        {
+            close(listFd);
+        }
+
+        // Queue subdirectories (counted first, so that they cannot finish before the directory is listed)
+        if (!subdirs.empty())
+        {
+            dir->pending += static_cast<unsigned int>(subdirs.size());
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_queue.insert(m_queue.end(), subdirs.begin(), subdirs.end());
+            }
+
+            m_condition.notify_all();
+        }
+
+        finish(dir);
+    }
+
+    // Remove directories whose contents are gone, from the given directory upwards
+    void finish(Directory * dir)
+    {
+        while (dir && --dir->pending == 0)
+        {
+            if (dir->fd >= 0)
+            {
+                close(dir->fd);
+                dir->fd = -1;
+            }
+
+            // The parent stays open until all of its subdirectories are finished
+            unlinkat(dir->parent ? dir->parent->fd : AT_FDCWD, dir->name.c_str(), AT_REMOVEDIR);
+            dir = dir->parent;
+        }
+    }
+
+
+protected:
+    unsigned int                            m_workers;   ///< Number of threads
+    std::deque<std::unique_ptr<Directory>>  m_dirs;      ///< All directories of the tree
+    std::deque<Directory *>                 m_queue;     ///< Directories to list
+    unsigned int                            m_active;    ///< Number of directories that are being listed
+    std::mutex                              m_mutex;     ///< Protects the directories and the queue
+    std::condition_variable                 m_condition; ///< Signals new directories and finished directories
+    const std::atomic<bool>               * m_cancel;    ///< Stop listing further directories when set (can be null)
+};
+
+// Get number of threads for removing directory trees
+unsigned int removalWorkers()
+{
+    return std::min(std::max(std::thread::hardware_concurrency(), 1u), 8u);
+}
+
+// Background thread that removes directories which have been moved to the trash
+class BackgroundRemoval
+{
+public:
+    // Get instance
+    static BackgroundRemoval & instance()
+    {
+        static BackgroundRemoval removal;
+        return removal;
+    }
+
+    // Pending removals are continued for a limited time when the program exits,
+    // remaining trash directories are collected by the next process that removes a directory next to them
+    ~BackgroundRemoval()
+    {
+        wait(2000);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+
+        m_cancel = true;
+        m_condition.notify_all();
+
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+
+    // Queue directory for removal
+    void add(const std::string & path)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            m_queue.push_back(path);
+
+            if (!m_thread.joinable())
+            {
+                m_thread = std::thread(&BackgroundRemoval::run, this);
+            }
+        }
+
+        m_condition.notify_all();
+    }
+
+    // Get number of directories that are queued or being removed
+    unsigned int pending()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return static_cast<unsigned int>(m_queue.size()) + (m_busy ? 1 : 0);
+    }
+
+    // Wait until all directories have been removed (negative timeout for infinite)
+    bool wait(int timeout)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto done = [this] { return m_queue.empty() && !m_busy; };
+
+        if (timeout < 0)
+        {
+            m_condition.wait(lock, done);
+            return true;
+        }
+
+        return m_condition.wait_for(lock, std::chrono::milliseconds(timeout), done);
+    }
+
+
+protected:
+    BackgroundRemoval()
+    : m_stop(false)
+    , m_busy(false)
+    , m_cancel(false)
+    {
+    }
+
+    // Remove queued directories until stopped and the queue is empty
+    void run()
+    {
+        while (true)
+        {
+            std::string path;
+
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_busy = false;
+                m_condition.notify_all();
+
+                m_condition.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+                if (m_queue.empty() || m_cancel) break;
+
+                path = std::move(m_queue.front());
+                m_queue.pop_front();
+                m_busy = true;
+            }
+
+            // Collect trash that has been left behind by processes that have exited
+            std::string parent = cppfs::FilePath(path).directoryPath();
+            if (m_swept.insert(parent).second)
+            {
+                sweep(parent);
+            }
+
+            TreeRemoval removal(removalWorkers(), &m_cancel);
+            removal.run(path);
+        }
+    }
+
+    // Queue trash directories of processes that no longer exist
+    void sweep(const std::string & dir)
+    {
+        DIR * handle = opendir(dir.c_str());
+        if (!handle) return;
+
+        std::vector<std::string> stale;
+        std::string prefix = ".cppfs-trash-";
+
+        while (struct dirent * entry = readdir(handle))
+        {
+            std::string name = entry->d_name;
+            if (name.compare(0, prefix.size(), prefix) != 0) continue;
+
+            // Get process that has created the trash directory
+            pid_t pid = static_cast<pid_t>(std::strtol(name.c_str() + prefix.size(), nullptr, 10));
+            if (pid <= 0 || pid == getpid() || kill(pid, 0) == 0 || errno != ESRCH) continue;
+
+            stale.push_back(cppfs::FilePath(dir).resolve(name).fullPath());
+        }
+
+        closedir(handle);
+
+        if (!stale.empty())
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.insert(m_queue.end(), stale.begin(), stale.end());
+        }
+    }
+
+
+protected:
+    std::deque<std::string> m_queue;     ///< Directories to remove
+    std::set<std::string>   m_swept;     ///< Directories that have been checked for stale trash (only used by the background thread)
+    bool                    m_stop;      ///< Stop when the queue is empty?
+    bool                    m_busy;      ///< Is a directory being removed?
+    std::atomic<bool>       m_cancel;    ///< Abort removals that are in progress?
+    std::mutex              m_mutex;     ///< Protects the queue and flags
+    std::condition_variable m_condition; ///< Signals new directories and finished removals
+    std::thread             m_thread;    ///< Background thread (started on demand)
+};
+
+
+
+// Get suffix that makes names of temporary files unique
+std::string uniqueSuffix()
+{
+    static std::atomic<unsigned int> counter(0);
+
+    return std::to_string(getpid()) + "-" + std::to_string(counter++);
+}
+
+// Get path of the file that a chain of symbolic links points to (empty on error)
+std::string resolveLinks(std::string path)
+{
+    for (int i = 0; i < 40; i++)
+    {
+        // Stop at the first path that is not a link (it may not exist yet)
+        struct stat info;
+        if (lstat(path.c_str(), &info) != 0 || !S_ISLNK(info.st_mode))
+        {
+            return path;
+        }
+
+        // Get link target
+        std::vector<char> target(static_cast<size_t>(info.st_size > 0 ? info.st_size : 255) + 1);
+        ssize_t size = readlink(path.c_str(), target.data(), target.size());
+        if (size < 0 || static_cast<size_t>(size) >= target.size()) return "";
+
+        // Relative targets are relative to the directory of the link
+        std::string link(target.data(), static_cast<size_t>(size));
+        path = cppfs::FilePath(cppfs::FilePath(path).directoryPath()).resolve(link).fullPath();
+    }
+
+    // Too many levels of links
+    return "";
+}
+
+// Write content to a new file (applying the owner and permissions of the file it replaces, if any)
+bool writeContent(int fd, const std::string & content, const struct stat * replaced, bool sync)
+{
+    if (replaced)
+    {
+        if (fchown(fd, replaced->st_uid, replaced->st_gid) != 0)
+        {
+            // Owner can only be changed by privileged users
+        }
+
+        if (fchmod(fd, replaced->st_mode & 07777) != 0) return false;
+    }
+
+    const char * data = content.data();
+    size_t       size = content.size();
+
+    while (size > 0)
+    {
+        ssize_t written = write(fd, data, size);
+
+        if (written < 0)
+        {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+
+#ifdef __APPLE__
+    return !sync || fsync(fd) == 0;
+#else
+    return !sync || fdatasync(fd) == 0;
+#endif
+}
+
+// Flush directory entries to disk
+bool syncDirectory(const std::string & path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    bool result = (fsync(fd) == 0);
+    close(fd);
+
+    return result;
+}
+
+} // namespace
+
 
 namespace cppfs
 {
@@ -339,7 +1348,72 @@ bool LocalFileHandle::removeDirectory()
     return true;
 }
 
-bool LocalFileHandle::copy(AbstractFileHandleBackend & dest)
+AbstractFileHandleBackend::CopyResult LocalFileHandle::copyDirectoryRec(AbstractFileHandleBackend & dest, const CopyOptions & options)
+{
+    // Copy the tree with file descriptors instead of handles, so that each entry is examined only once
+    TreeCopy copy(options);
+    bool result = copy.run(m_path, dest.path());
+
+    // Done
+    dest.updateFileInfo();
+    return result ? CopySucceeded : CopyFailed;
+}
+
+bool LocalFileHandle::cloneDirectory(AbstractFileHandleBackend & dest, const CopyOptions & options, unsigned long long & clonedBytes, unsigned long long & copiedBytes)
+{
+    // Clone files where the file system supports it and copy the others
+    TreeCopy copy(options, true);
+    bool result = copy.run(m_path, dest.path());
+
+    clonedBytes = copy.clonedBytes();
+    copiedBytes = copy.copiedBytes();
+
+    // Done
+    dest.updateFileInfo();
+    return result;
+}
+
+bool LocalFileHandle::removeDirectoryRec()
+{
+    // Remove the tree with directory file descriptors on several threads
+    TreeRemoval removal(removalWorkers());
+    bool result = removal.run(m_path);
+
+    // Done
+    updateFileInfo();
+    return result;
+}
+
+bool LocalFileHandle::removeDirectoryRecAsync()
+{
+    // Move directory to a hidden name on the same file system, so that renaming is atomic
+    std::string filename = ".cppfs-trash-" + uniqueSuffix();
+    std::string trash    = FilePath(FilePath(m_path).directoryPath()).resolve(filename).fullPath();
+
+    if (::rename(m_path.c_str(), trash.c_str()) != 0)
+    {
+        return false;
+    }
+
+    // Remove it in the background
+    BackgroundRemoval::instance().add(trash);
+
+    // Done
+    updateFileInfo();
+    return true;
+}
+
+unsigned int LocalFileHandle::pendingRemovals()
+{
+    return BackgroundRemoval::instance().pending();
+}
+
+bool LocalFileHandle::waitForRemovals(int timeout)
+{
+    return BackgroundRemoval::instance().wait(timeout);
+}
+
+bool LocalFileHandle::copy(AbstractFileHandleBackend & dest, const CopyOptions & options)
 {
     // Check source file
     if (!isFile()) return false;
@@ -355,19 +1429,71 @@ bool LocalFileHandle::copy(AbstractFileHandleBackend & dest)
     }
 
     // Open files
-    std::ifstream in (src.c_str(), std::ios::binary);
-    std::ofstream out(dst.c_str(), std::ios::binary);
-    if (!in || !out)
+    int in = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0)
+    {
+        // Error!
+        return false;
+    }
+
+    struct stat info;
+    int out = (fstat(in, &info) == 0) ? ::open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666) : -1;
+    if (out < 0)
     {
         // Error!
+        ::close(in);
         return false;
     }
 
-    // Copy file
-    out << in.rdbuf();
+    // Copy file (only the data regions are copied, holes in sparse files are kept)
+    bool  result   = true;
+    off_t size     = info.st_size;
+    off_t chunk    = static_cast<off_t>(options.chunkSize());
+    bool  sparse   = static_cast<off_t>(info.st_blocks) * 512 < size;
+    bool  parallel = options.workers() > 1 && size >= 2 * chunk;
+
+    // Allocate the destination file up front for parallel copies (but do not fill holes)
+    setFileSize(out, size, parallel && !sparse);
+
+    if (parallel)
+    {
+        // Copy ranges of large files on several threads
+        std::atomic<off_t> next(0);
+        std::atomic<bool>  failed(false);
+
+        std::vector<std::thread> workers;
+        for (unsigned int i = 0; i < options.workers(); i++)
+        {
+            workers.emplace_back([&] ()
+            {
+                off_t offset;
+                while (!failed && (offset = next.fetch_add(chunk)) < size)
+                {
+                    if (!copyData(in, out, offset, std::min(offset + chunk, size)))
+                    {
+                        failed = true;
+                    }
+                }
+            });
+        }
+
+        for (auto & worker : workers)
+        {
+            worker.join();
+        }
+
+        result = !failed;
+    }
+    else
+    {
+        result = copyData(in, out, 0, size);
+    }
+
+    ::close(in);
+    if (::close(out) != 0) result = false;
 
     // Done
-    return true;
+    return result;
 }
 
 bool LocalFileHandle::move(AbstractFileHandleBackend & dest)
@@ -385,7 +1511,7 @@ bool LocalFileHandle::move(AbstractFileHandleBackend & dest)
         dst = FilePath(dest.path()).resolve(filename).fullPath();
     }
 
-    // Move file
+    // Move file (fails with EXDEV if the destination is on another device)
     if (::rename(src.c_str(), dst.c_str()) != 0)
     {
         return false;
@@ -497,6 +1623,101 @@ std::unique_ptr<std::ostream> LocalFileHandle::createOutputStream(std::ios_base:
     return std::unique_ptr<std::ostream>(new std::ofstream(m_path, mode));
 }
 
+bool LocalFileHandle::writeFileAtomic(const std::string & content, bool sync)
+{
+    // Check file
+    if (isDirectory()) return false;
+
+    // Replace the file that a link points to, not the link itself
+    std::string path = resolveLinks(m_path);
+    if (path.empty()) return false;
+
+    // Get attributes of the file that is replaced
+    struct stat info;
+    bool replace = (stat(path.c_str(), &info) == 0);
+
+    // Get directory and name of the temporary file
+    std::string dir  = FilePath(path).directoryPath();
+    std::string temp = dir + "." + FilePath(path).fileName() + ".cppfs-" + uniqueSuffix();
+    if (dir.empty()) dir = ".";
+
+    bool written = false;
+
+#ifdef O_TMPFILE
+    // Write a file without name and link it into the directory once it is complete
+    int fd = open(dir.c_str(), O_TMPFILE | O_WRONLY | O_CLOEXEC, 0666);
+
+    if (fd >= 0)
+    {
+        std::string link = "/proc/self/fd/" + std::to_string(fd);
+
+        written = writeContent(fd, content, replace ? &info : nullptr, sync) &&
+                  linkat(AT_FDCWD, link.c_str(), AT_FDCWD, temp.c_str(), AT_SYMLINK_FOLLOW) == 0;
+
+        close(fd);
+    }
+#endif
+
+    // Otherwise (e.g., the file system does not support it), write a hidden file
+    if (!written)
+    {
+        int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+        if (fd < 0) return false;
+
+        written = writeContent(fd, content, replace ? &info : nullptr, sync);
+        if (close(fd) != 0) written = false;
+
+        if (!written)
+        {
+            unlink(temp.c_str());
+            return false;
+        }
+    }
+
+    // Replace file
+    if (::rename(temp.c_str(), path.c_str()) != 0)
+    {
+        unlink(temp.c_str());
+        return false;
+    }
+
+    // Flush the new directory entry
+    bool result = !sync || syncDirectory(dir);
+
+    // Done
+    updateFileInfo();
+    return result;
+}
+
+bool LocalFileHandle::syncFileSystem()
+{
+#ifdef __linux__
+    // Flush only the file system that contains the file
+    int fd = open(m_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    bool result = (syncfs(fd) == 0);
+    close(fd);
+
+    return result;
+#else
+    sync();
+    return true;
+#endif
+}
+
+unsigned long long LocalFileHandle::deviceId() const
+{
+    readFileInfo();
+
+    if (m_fileInfo)
+    {
+        return static_cast<unsigned long long>(((struct stat *)m_fileInfo)->st_dev);
+    }
+
+    return 0;
+}
+
 void LocalFileHandle::readFileInfo() const
 {
     // Check if file info has already been read
@@ -2,6 +2,7 @@
 #include <cppfs/posix/LocalFileIterator.h>
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 
 #include <cppfs/posix/LocalFileSystem.h>
@@ -88,6 +89,32 @@ void LocalFileIterator::next()
     readNextEntry();
 }
 
+bool LocalFileIterator::entryInfo(EntryInfo & info) const
+{
+    // Check directory and entry handle
+    if (!m_dir || !m_entry)
+    {
+        return false;
+    }
+
+    // Query entry relative to the open directory
+    struct stat fileInfo;
+    if (fstatat(dirfd(m_dir), m_entry->d_name, &fileInfo, AT_SYMLINK_NOFOLLOW) != 0)
+    {
+        return false;
+    }
+
+    info.isDirectory      = S_ISDIR(fileInfo.st_mode);
+    info.isSymbolicLink   = S_ISLNK(fileInfo.st_mode);
+    info.size             = static_cast<unsigned int>(fileInfo.st_size);
+    info.modificationTime = static_cast<unsigned int>(fileInfo.st_mtime);
+    info.permissions      = static_cast<unsigned long>(fileInfo.st_mode & 07777);
+    info.userId           = static_cast<unsigned int>(fileInfo.st_uid);
+    info.groupId          = static_cast<unsigned int>(fileInfo.st_gid);
+
+    return true;
+}
+
 void LocalFileIterator::readNextEntry()
 {
     // Check directory handle
@@ -4,10 +4,12 @@
 #include <cppfs/FileHandle.h>
 #include <cppfs/FileWatcher.h>
 #include <cppfs/AbstractFileWatcherBackend.h>
+#include <cppfs/PollingFileWatcher.h>
 #include <cppfs/posix/LocalFileHandle.h>
 
 #ifdef SYSTEM_LINUX
     #include <cppfs/linux/LocalFileWatcher.h>
+    #include <cppfs/linux/FanotifyFileWatcher.h>
 #endif
 
 
@@ -37,14 +39,31 @@ FileHandle LocalFileSystem::open(std::string && path)
     );
 }
 
-std::unique_ptr<AbstractFileWatcherBackend> LocalFileSystem::createFileWatcher(FileWatcher & fileWatcher)
+std::unique_ptr<AbstractFileWatcherBackend> LocalFileSystem::createFileWatcher(FileWatcher & fileWatcher, WatcherType type)
 {
+    if (type == PollingWatcher)
+    {
+        return std::unique_ptr<AbstractFileWatcherBackend>(
+                new PollingFileWatcher(&fileWatcher, shared_from_this())
+        );
+    }
+
 #ifdef SYSTEM_LINUX
+    if (type == FanotifyWatcher)
+    {
+        return std::unique_ptr<AbstractFileWatcherBackend>(
+                new FanotifyFileWatcher(&fileWatcher, shared_from_this())
+        );
+    }
+
     return std::unique_ptr<AbstractFileWatcherBackend>(
             new LocalFileWatcher(&fileWatcher, shared_from_this())
     );
 #else
-    return nullptr;
+    // Fall back to polling on systems without a native watcher
+    return std::unique_ptr<AbstractFileWatcherBackend>(
+            new PollingFileWatcher(&fileWatcher, shared_from_this())
+    );
 #endif
 }
 
@@ -0,0 +1,400 @@
+
+#include <cppfs/ssh/SshEventLoop.h>
+
+#ifdef WIN32
+    #include <winsock2.h>
+#else
+    #include <poll.h>
+#endif
+
+#include <algorithm>
+
+#include <libssh2.h>
+#include <libssh2_sftp.h>
+
+#include <cppfs/FilePath.h>
+#include <cppfs/ssh/SshFileSystem.h>
+#include <cppfs/ssh/SshSession.h>
+
+
+namespace
+{
+
+
+// State of an operation that delivers a typed result
+template <typename T>
+struct OperationState
+{
+    OperationState(T defaultValue)
+    : value(std::move(defaultValue))
+    , done(false)
+    {
+    }
+
+    ~OperationState()
+    {
+        // Deliver default value if the operation has not been run
+        if (!done) result.set_value(std::move(value));
+    }
+
+    void finish()
+    {
+        done = true;
+        result.set_value(std::move(value));
+    }
+
+    std::promise<T> result;
+    T               value;
+    bool            done;
+};
+
+
+} // namespace
+
+
+namespace cppfs
+{
+
+
+SshEventLoop::SshEventLoop(SshFileSystem & fs, std::unique_ptr<SshSession> session, unsigned int channels)
+: m_fs(fs)
+, m_session(std::move(session))
+, m_stop(false)
+{
+    // Open SFTP channels (in blocking mode)
+    if (m_session->session())
+    {
+        for (unsigned int i = 0; i < std::max(channels, 1u); i++)
+        {
+            void * sftp = m_session->openSftpChannel();
+            if (!sftp) break;
+
+            m_channels.push_back(sftp);
+        }
+    }
+
+    // Switch to non-blocking mode and start event loop
+    m_session->setBlocking(false);
+    m_thread = std::thread(&SshEventLoop::run, this);
+}
+
+SshEventLoop::~SshEventLoop()
+{
+    // Stop event loop
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_condition.notify_one();
+    m_thread.join();
+
+    // Close SFTP channels
+    m_session->setBlocking(true);
+
+    for (void * sftp : m_channels)
+    {
+        libssh2_sftp_shutdown((LIBSSH2_SFTP *)sftp);
+    }
+}
+
+bool SshEventLoop::isConnected() const
+{
+    return !m_channels.empty();
+}
+
+std::future<int> SshEventLoop::submit(Operation operation)
+{
+    std::unique_ptr<Task> task(new Task);
+    task->operation = std::move(operation);
+
+    std::future<int> result = task->result.get_future();
+
+    // Fail if there is no channel to run the operation on
+    if (m_channels.empty())
+    {
+        task->result.set_value(-1);
+        return result;
+    }
+
+    // Add operation to the queue
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_stop)
+        {
+            task->result.set_value(-1);
+            return result;
+        }
+
+        m_queue.push_back(std::move(task));
+    }
+
+    m_condition.notify_one();
+    return result;
+}
+
+std::future<bool> SshEventLoop::stat(const std::string & path)
+{
+    auto state = std::make_shared<OperationState<bool>>(false);
+    std::future<bool> result = state->result.get_future();
+
+    SshFileSystem & fs = m_fs;
+
+    submit([state, path, &fs] (void *, void * sftp) -> int
+    {
+        // Get attributes (links are not resolved, like in directory listings)
+        LIBSSH2_SFTP_ATTRIBUTES attrs;
+        int res = libssh2_sftp_stat_ex((LIBSSH2_SFTP *)sftp, path.c_str(), path.length(), LIBSSH2_SFTP_LSTAT, &attrs);
+        if (res == LIBSSH2_ERROR_EAGAIN) return res;
+
+        // Keep attributes for the next handle
+        if (res == 0)
+        {
+            fs.cacheAttributes(path, attrs);
+        }
+
+        state->value = (res == 0);
+        state->finish();
+        return res;
+    });
+
+    return result;
+}
+
+std::future<std::vector<std::string>> SshEventLoop::listFiles(const std::string & path)
+{
+    struct ListState : public OperationState<std::vector<std::string>>
+    {
+        ListState() : OperationState<std::vector<std::string>>(std::vector<std::string>()), dir(nullptr), closing(false) { }
+        LIBSSH2_SFTP_HANDLE * dir;
+        bool                  closing;
+    };
+
+    auto state = std::make_shared<ListState>();
+    std::future<std::vector<std::string>> result = state->result.get_future();
+
+    SshFileSystem & fs = m_fs;
+
+    submit([state, path, &fs] (void * session, void * sftp) -> int
+    {
+        // Open directory
+        if (!state->dir)
+        {
+            state->dir = libssh2_sftp_open_ex((LIBSSH2_SFTP *)sftp, path.c_str(), path.length(), 0, 0, LIBSSH2_SFTP_OPENDIR);
+
+            if (!state->dir)
+            {
+                int res = libssh2_session_last_errno((LIBSSH2_SESSION *)session);
+                if (res == LIBSSH2_ERROR_EAGAIN) return res;
+
+                state->finish();
+                return -1;
+            }
+        }
+
+        // List entries
+        if (!state->closing)
+        {
+            char name[512];
+            char longName[512];
+            LIBSSH2_SFTP_ATTRIBUTES attrs;
+
+            int res = 0;
+            while ((res = libssh2_sftp_readdir_ex(state->dir, name, sizeof(name), longName, sizeof(longName), &attrs)) > 0)
+            {
+                std::string filename(name);
+
+                if (filename != "." && filename != "..")
+                {
+                    state->value.push_back(filename);
+
+                    // Keep attributes for handles that are opened on the entry
+                    if (attrs.flags & LIBSSH2_SFTP_ATTR_PERMISSIONS)
+                    {
+                        fs.cacheAttributes(FilePath(path).resolve(filename).fullPath(), attrs);
+                    }
+                }
+            }
+
+            if (res == LIBSSH2_ERROR_EAGAIN) return res;
+
+            state->closing = true;
+        }
+
+        // Close directory
+        if (libssh2_sftp_close_handle(state->dir) == LIBSSH2_ERROR_EAGAIN) return LIBSSH2_ERROR_EAGAIN;
+
+        state->finish();
+        return 0;
+    });
+
+    return result;
+}
+
+std::future<std::string> SshEventLoop::readFile(const std::string & path)
+{
+    struct ReadState : public OperationState<std::string>
+    {
+        ReadState() : OperationState<std::string>(""), file(nullptr), closing(false), failed(false) { }
+        LIBSSH2_SFTP_HANDLE * file;
+        bool                  closing;
+        bool                  failed;
+    };
+
+    auto state = std::make_shared<ReadState>();
+    std::future<std::string> result = state->result.get_future();
+
+    submit([state, path] (void * session, void * sftp) -> int
+    {
+        // Open file
+        if (!state->file)
+        {
+            state->file = libssh2_sftp_open_ex((LIBSSH2_SFTP *)sftp, path.c_str(), path.length(), LIBSSH2_FXF_READ, 0, LIBSSH2_SFTP_OPENFILE);
+
+            if (!state->file)
+            {
+                int res = libssh2_session_last_errno((LIBSSH2_SESSION *)session);
+                if (res == LIBSSH2_ERROR_EAGAIN) return res;
+
+                state->finish();
+                return -1;
+            }
+        }
+
+        // Read file
+        if (!state->closing)
+        {
+            char buffer[30000];
+
+            ssize_t res = 0;
+            while ((res = libssh2_sftp_read(state->file, buffer, sizeof(buffer))) > 0)
+            {
+                state->value.append(buffer, res);
+            }
+
+            if (res == LIBSSH2_ERROR_EAGAIN) return LIBSSH2_ERROR_EAGAIN;
+
+            // Discard incomplete content
+            if (res < 0)
+            {
+                state->failed = true;
+                state->value.clear();
+            }
+
+            state->closing = true;
+        }
+
+        // Close file
+        if (libssh2_sftp_close_handle(state->file) == LIBSSH2_ERROR_EAGAIN) return LIBSSH2_ERROR_EAGAIN;
+
+        state->finish();
+        return state->failed ? -1 : 0;
+    });
+
+    return result;
+}
+
+void SshEventLoop::run()
+{
+    std::vector<std::unique_ptr<Task>> active(m_channels.size());
+
+    while (true)
+    {
+        // Get new operations
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            bool idle = std::none_of(active.begin(), active.end(), [] (const std::unique_ptr<Task> & task) { return task != nullptr; });
+
+            if (idle)
+            {
+                m_condition.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+                if (m_stop) break;
+            }
+
+            if (!m_stop)
+            {
+                for (size_t i = 0; i < active.size() && !m_queue.empty(); i++)
+                {
+                    if (!active[i])
+                    {
+                        active[i] = std::move(m_queue.front());
+                        m_queue.pop_front();
+                    }
+                }
+            }
+        }
+
+        // Run operations until they have to wait for the server
+        bool progress = false;
+        bool busy     = true;
+
+        for (size_t i = 0; i < active.size(); i++)
+        {
+            if (!active[i])
+            {
+                busy = false;
+                continue;
+            }
+
+            int res = active[i]->operation(m_session->session(), m_channels[i]);
+
+            if (res != LIBSSH2_ERROR_EAGAIN)
+            {
+                active[i]->result.set_value(res);
+                active[i].reset();
+                progress = true;
+            }
+        }
+
+        // Wait for the server, but look for new operations regularly while channels are free
+        if (!progress)
+        {
+            waitSocket(busy ? 1000 : 10);
+        }
+    }
+
+    // Operations that have not been started are finished with an error
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto & task : m_queue)
+    {
+        task->result.set_value(-1);
+    }
+
+    m_queue.clear();
+}
+
+void SshEventLoop::waitSocket(int timeout)
+{
+    // Get directions in which libssh2 is blocked
+    int directions = libssh2_session_block_directions((LIBSSH2_SESSION *)m_session->session());
+
+    struct pollfd fd;
+    fd.fd      = m_session->socket();
+    fd.events  = 0;
+    fd.revents = 0;
+
+    if (directions & LIBSSH2_SESSION_BLOCK_INBOUND)  fd.events |= POLLIN;
+    if (directions & LIBSSH2_SESSION_BLOCK_OUTBOUND) fd.events |= POLLOUT;
+
+    // Not blocked in a known direction (e.g., no operation has been started yet),
+    // wait shortly for incoming data, so that the loop does not spin. The socket
+    // is writable almost always, so waiting for POLLOUT would return immediately.
+    if (fd.events == 0)
+    {
+        fd.events = POLLIN;
+        timeout   = std::min(timeout, 10);
+    }
+
+    // Wait for socket
+#ifdef WIN32
+    WSAPoll(&fd, 1, timeout);
+#else
+    poll(&fd, 1, timeout);
+#endif
+}
+
+
+} // namespace cppfs
@@ -6,12 +6,14 @@
 
 #include <cppfs/cppfs.h>
 #include <cppfs/FilePath.h>
+#include <cppfs/CopyOptions.h>
 #include <cppfs/InputStream.h>
 #include <cppfs/OutputStream.h>
 #include <cppfs/ssh/SshFileSystem.h>
 #include <cppfs/ssh/SshFileIterator.h>
 #include <cppfs/ssh/SshInputStreamBuffer.h>
 #include <cppfs/ssh/SshOutputStreamBuffer.h>
+#include <cppfs/ssh/SshSession.h>
 
 
 namespace cppfs
@@ -51,6 +53,9 @@ AbstractFileSystem * SshFileHandle::fs() const
 
 void SshFileHandle::updateFileInfo()
 {
+    // Discard cached attributes
+    m_fs->invalidateAttributes(m_path);
+
     // Reset file information
     if (m_fileInfo)
     {
@@ -147,15 +152,13 @@ std::vector<std::string> SshFileHandle::listFiles() const
 {
     std::vector<std::string> entries;
 
-    // Check handle
-    if (!m_fs->m_session) return entries;
-
-    // Initialize SFTP sub-protocol
-    m_fs->initSftp();
-    if (!m_fs->m_sftpSession) return entries;
+    // Get session
+    std::unique_lock<std::recursive_mutex> lock;
+    LIBSSH2_SFTP * sftp = (LIBSSH2_SFTP *)m_fs->acquireSession(lock).sftpSession();
+    if (!sftp) return entries;
 
     // Open directory
-    LIBSSH2_SFTP_HANDLE * dir = libssh2_sftp_opendir((LIBSSH2_SFTP *)m_fs->m_sftpSession, m_path.c_str());
+    LIBSSH2_SFTP_HANDLE * dir = libssh2_sftp_opendir(sftp, m_path.c_str());
     if (!dir) return entries;
 
     // List entries
@@ -170,6 +173,12 @@ std::vector<std::string> SshFileHandle::listFiles() const
         if (filename != "." && filename != "..")
         {
             entries.push_back(filename);
+
+            // Keep attributes for handles that are opened on the entry
+            if (attrs.flags & LIBSSH2_SFTP_ATTR_PERMISSIONS)
+            {
+                m_fs->cacheAttributes(FilePath(m_path).resolve(filename).fullPath(), attrs);
+            }
         }
     }
 
@@ -254,8 +263,13 @@ void SshFileHandle::setUserId(unsigned int uid)
     attrs.uid = uid;
     attrs.gid = groupId();
 
+    // Get session
+    std::unique_lock<std::recursive_mutex> lock;
+    LIBSSH2_SFTP * sftp = (LIBSSH2_SFTP *)m_fs->acquireSession(lock).sftpSession();
+    if (!sftp) return;
+
     libssh2_sftp_stat_ex(
-        (LIBSSH2_SFTP *)m_fs->m_sftpSession,
+        sftp,
         m_path.c_str(),
         m_path.length(),
         LIBSSH2_SFTP_SETSTAT,
@@ -288,8 +302,13 @@ void SshFileHandle::setGroupId(unsigned int gid)
     attrs.uid = userId();
     attrs.gid = gid;
 
+    // Get session
+    std::unique_lock<std::recursive_mutex> lock;
+    LIBSSH2_SFTP * sftp = (LIBSSH2_SFTP *)m_fs->acquireSession(lock).sftpSession();
+    if (!sftp) return;
+
     libssh2_sftp_stat_ex(
-        (LIBSSH2_SFTP *)m_fs->m_sftpSession,
+        sftp,
         m_path.c_str(),
         m_path.length(),
         LIBSSH2_SFTP_SETSTAT,
@@ -335,12 +354,10 @@ unsigned long SshFileHandle::permissions() const
 
 void SshFileHandle::setPermissions(unsigned long permissions)
 {
-    // Check handle
-    if (!m_fs->m_session) return;
-
-    // Initialize SFTP sub-protocol
-    m_fs->initSftp();
-    if (!m_fs->m_sftpSession) return;
+    // Get session
+    std::unique_lock<std::recursive_mutex> lock;
+    LIBSSH2_SFTP * sftp = (LIBSSH2_SFTP *)m_fs->acquireSession(lock).sftpSession();
+    if (!sftp) return;
 
     // Convert permission flags
     unsigned long mode = 0;
@@ -370,7 +387,7 @@ void SshFileHandle::setPermissions(unsigned long permissions)
     attrs.permissions = mode;
 
     libssh2_sftp_stat_ex(
-        (LIBSSH2_SFTP *)m_fs->m_sftpSession,
+        sftp,
         m_path.c_str(),
         m_path.length(),
         LIBSSH2_SFTP_SETSTAT,
@@ -383,18 +400,16 @@ void SshFileHandle::setPermissions(unsigned long permissions)
 
 bool SshFileHandle::createDirectory()
 {
-    // Check handle
-    if (!m_fs->m_session) return false;
-
-    // Initialize SFTP sub-protocol
-    m_fs->initSftp();
-    if (!m_fs->m_sftpSession) return false;
-
     // Check directory
     if (exists()) return false;
 
+    // Get session
+    std::unique_lock<std::recursive_mutex> lock;
+    LIBSSH2_SFTP * sftp = (LIBSSH2_SFTP *)m_fs->acquireSession(lock).sftpSession();
+    if (!sftp) return false;
+
     // Create directory
-    if (libssh2_sftp_mkdir((LIBSSH2_SFTP *)m_fs->m_sftpSession, m_path.c_str(), 0755) != 0)
+    if (libssh2_sftp_mkdir(sftp, m_path.c_str(), 0755) != 0)
     {
         return false;
     }
@@ -406,18 +421,16 @@ bool SshFileHandle::createDirectory()
 
 bool SshFileHandle::removeDirectory()
 {
-    // Check handle
-    if (!m_fs->m_session) return false;
-
-    // Initialize SFTP sub-protocol
-    m_fs->initSftp();
-    if (!m_fs->m_sftpSession) return false;
-
     // Check directory
     if (!isDirectory()) return false;
 
+    // Get session
+    std::unique_lock<std::recursive_mutex> lock;
+    LIBSSH2_SFTP * sftp = (LIBSSH2_SFTP *)m_fs->acquireSession(lock).sftpSession();
+    if (!sftp) return false;
+
     // Create directory
-    if (libssh2_sftp_rmdir((LIBSSH2_SFTP *)m_fs->m_sftpSession, m_path.c_str()) != 0)
+    if (libssh2_sftp_rmdir(sftp, m_path.c_str()) != 0)
     {
         return false;
     }
@@ -427,16 +440,57 @@ bool SshFileHandle::removeDirectory()
     return true;
 }
 
-bool SshFileHandle::copy(AbstractFileHandleBackend & dest)
+AbstractFileHandleBackend::CopyResult SshFileHandle::copyDirectoryRec(AbstractFileHandleBackend & dest, const CopyOptions & options)
+{
+    // Check source directory
+    if (!isDirectory()) return CopyNotSupported;
+
+    // Re-create links ('-P') or follow them like the generic implementation ('-L'),
+    // and keep permissions, owner and times only if requested ('-p'). With both,
+    // use '-a', which also keeps hard links with GNU cp.
+    std::string flags = options.preserveLinks() ? "-RP" : "-RL";
+    if (options.preserveMetadata()) flags += "p";
+    if (options.preserveLinks() && options.preserveMetadata()) flags = "-a";
+
+    // Copy the contents of the directory with 'cp' on the remote machine.
+    // The destination directory is created if necessary, existing files are overwritten.
+    std::string src = m_path + (!m_path.empty() && m_path.back() == '/' ? "." : "/.");
+    std::string cmd = "cp " + flags + " -- " + SshFileSystem::quote(src) + " " + SshFileSystem::quote(dest.path());
+
+    int status = m_fs->execute(cmd);
+
+    // Commands cannot be executed or 'cp' is not available, nothing has been copied
+    if (status < 0 || status == 127)
+    {
+        return CopyNotSupported;
+    }
+
+    m_fs->invalidateAttributes(dest.path());
+
+    // Done
+    return (status == 0) ? CopySucceeded : CopyFailed;
+}
+
+bool SshFileHandle::removeDirectoryRec()
+{
+    // Check directory
+    if (!isDirectory()) return false;
+
+    // Remove directory tree with 'rm -rf' on the remote machine
+    bool result = m_fs->removeAll(std::vector<std::string>{ m_path });
+
+    // Done
+    updateFileInfo();
+    return result;
+}
+
+bool SshFileHandle::copy(AbstractFileHandleBackend & dest, const CopyOptions &)
 {
     // This copies a file by executing "cp <src> <dst>" on the remote machine
     // assuming a UNIX system that supports this command. This is of course
     // no ideal, but SCP/SFTP do not have any method to copy files on the remote
     // system without transferring it over network.
 
-    // Check handle
-    if (!m_fs->m_session) return false;
-
     // Check source file
     if (!isFile()) return false;
 
@@ -450,22 +504,14 @@ bool SshFileHandle::copy(AbstractFileHandleBackend & dest)
         dst = FilePath(dest.path()).resolve(filename).fullPath();
     }
 
-    // Open channel
-    LIBSSH2_CHANNEL * channel = libssh2_channel_open_session((LIBSSH2_SESSION *)m_fs->m_session);
-    if (!channel)
-    {
-        return false;
-    }
-
     // Copy file
-    std::string cmd = "cp \"" + src + "\" \"" + dst + "\"";
-    if (libssh2_channel_exec(channel, cmd.c_str()) != 0)
+    std::string cmd = "cp -- " + SshFileSystem::quote(src) + " " + SshFileSystem::quote(dst);
+    if (m_fs->execute(cmd) != 0)
     {
         return false;
     }
 
-    // Close channel
-    libssh2_channel_free(channel);
+    m_fs->invalidateAttributes(dst);
 
     // Done
     updateFileInfo();
@@ -474,13 +520,6 @@ bool SshFileHandle::copy(AbstractFileHandleBackend & dest)
 
 bool SshFileHandle::move(AbstractFileHandleBackend & dest)
 {
-    // Check handle
-    if (!m_fs->m_session) return false;
-
-    // Initialize SFTP sub-protocol
-    m_fs->initSftp();
-    if (!m_fs->m_sftpSession) return false;
-
     // Check source file
     if (!exists()) return false;
 
@@ -494,13 +533,19 @@ bool SshFileHandle::move(AbstractFileHandleBackend & dest)
         dst = FilePath(dest.path()).resolve(filename).fullPath();
     }
 
+    // Get session
+    std::unique_lock<std::recursive_mutex> lock;
+    LIBSSH2_SFTP * sftp = (LIBSSH2_SFTP *)m_fs->acquireSession(lock).sftpSession();
+    if (!sftp) return false;
+
     // Move file
-    if (libssh2_sftp_rename((LIBSSH2_SFTP *)m_fs->m_sftpSession, src.c_str(), dst.c_str()) != 0)
+    if (libssh2_sftp_rename(sftp, src.c_str(), dst.c_str()) != 0)
     {
         return false;
     }
 
     // Update path
+    m_fs->invalidateAttributes(m_path);
     m_path = dst;
     updateFileInfo();
 
@@ -516,13 +561,6 @@ bool SshFileHandle::createLink(AbstractFileHandleBackend &)
 
 bool SshFileHandle::createSymbolicLink(AbstractFileHandleBackend & dest)
 {
-    // Check handle
-    if (!m_fs->m_session) return false;
-
-    // Initialize SFTP sub-protocol
-    m_fs->initSftp();
-    if (!m_fs->m_sftpSession) return false;
-
     // Check source file
     if (!exists()) return false;
 
@@ -536,8 +574,13 @@ bool SshFileHandle::createSymbolicLink(AbstractFileHandleBackend & dest)
         dst = FilePath(dest.path()).resolve(filename).fullPath();
     }
 
+    // Get session
+    std::unique_lock<std::recursive_mutex> lock;
+    LIBSSH2_SFTP * sftp = (LIBSSH2_SFTP *)m_fs->acquireSession(lock).sftpSession();
+    if (!sftp) return false;
+
     // Create symbolic link
-    if (libssh2_sftp_symlink((LIBSSH2_SFTP *)m_fs->m_sftpSession, src.c_str(), const_cast<char *>(dst.c_str())) != 0)
+    if (libssh2_sftp_symlink(sftp, src.c_str(), const_cast<char *>(dst.c_str())) != 0)
     {
         return false;
     }
@@ -548,26 +591,25 @@ bool SshFileHandle::createSymbolicLink(AbstractFileHandleBackend & dest)
 
 bool SshFileHandle::rename(const std::string & filename)
 {
-    // Check handle
-    if (!m_fs->m_session) return false;
-
-    // Initialize SFTP sub-protocol
-    m_fs->initSftp();
-    if (!m_fs->m_sftpSession) return false;
-
     // Check file
     if (!exists()) return false;
 
+    // Get session
+    std::unique_lock<std::recursive_mutex> lock;
+    LIBSSH2_SFTP * sftp = (LIBSSH2_SFTP *)m_fs->acquireSession(lock).sftpSession();
+    if (!sftp) return false;
+
     // Compose new file path
     std::string path = FilePath(FilePath(m_path).directoryPath()).resolve(filename).fullPath();
 
     // Rename
-    if (libssh2_sftp_rename((LIBSSH2_SFTP *)m_fs->m_sftpSession, m_path.c_str(), path.c_str()) != 0)
+    if (libssh2_sftp_rename(sftp, m_path.c_str(), path.c_str()) != 0)
     {
         return false;
     }
 
     // Update path
+    m_fs->invalidateAttributes(m_path);
     m_path = path;
     updateFileInfo();
 
@@ -577,18 +619,16 @@ bool SshFileHandle::rename(const std::string & filename)
 
 bool SshFileHandle::remove()
 {
-    // Check handle
-    if (!m_fs->m_session) return false;
-
-    // Initialize SFTP sub-protocol
-    m_fs->initSftp();
-    if (!m_fs->m_sftpSession) return false;
-
     // Check source file
     if (!isFile()) return false;
 
+    // Get session
+    std::unique_lock<std::recursive_mutex> lock;
+    LIBSSH2_SFTP * sftp = (LIBSSH2_SFTP *)m_fs->acquireSession(lock).sftpSession();
+    if (!sftp) return false;
+
     // Delete file
-    if (libssh2_sftp_unlink((LIBSSH2_SFTP *)m_fs->m_sftpSession, m_path.c_str()) != 0)
+    if (libssh2_sftp_unlink(sftp, m_path.c_str()) != 0)
     {
         return false;
     }
@@ -600,54 +640,55 @@ bool SshFileHandle::remove()
 
 std::unique_ptr<std::istream> SshFileHandle::createInputStream(std::ios_base::openmode mode) const
 {
-    // Check handle
-    if (!m_fs->m_session) return nullptr;
-
-    // Initialize SFTP sub-protocol
-    m_fs->initSftp();
-    if (!m_fs->m_sftpSession) return nullptr;
-
     // Check source file
     if (!isFile()) return nullptr;
 
     // Create stream
     return std::unique_ptr<std::istream>(
-        new InputStream(new SshInputStreamBuffer(m_fs, m_path, mode))
+        new InputStream(new SshInputStreamBuffer(m_fs, m_path, mode, m_fs->readBufferSize()))
     );
 }
 
 std::unique_ptr<std::ostream> SshFileHandle::createOutputStream(std::ios_base::openmode mode)
 {
-    // Check handle
-    if (!m_fs->m_session) return nullptr;
+    // Check connection
+    {
+        std::unique_lock<std::recursive_mutex> lock;
+        if (!m_fs->acquireSession(lock).sftpSession()) return nullptr;
+    }
 
-    // Initialize SFTP sub-protocol
-    m_fs->initSftp();
-    if (!m_fs->m_sftpSession) return nullptr;
+    // Discard cached attributes, the file is going to change
+    updateFileInfo();
 
     // Create stream
     return std::unique_ptr<std::ostream>(
-        new OutputStream(new SshOutputStreamBuffer(m_fs, m_path, mode))
+        new OutputStream(new SshOutputStreamBuffer(m_fs, m_path, mode, m_fs->writeBufferSize()))
     );
 }
 
+bool SshFileHandle::syncFileSystem()
+{
+    return m_fs->sync();
+}
+
 void SshFileHandle::readFileInfo() const
 {
     // Check if file info has already been read
     if (m_fileInfo) return;
 
-    // Check handle
-    if (!m_fs->m_session) return;
+    // Use attributes from a directory listing
+    if (readCachedInfo() && m_fileInfo) return;
 
-    // Initialize SFTP sub-protocol
-    m_fs->initSftp();
-    if (!m_fs->m_sftpSession) return;
+    // Get session
+    std::unique_lock<std::recursive_mutex> lock;
+    LIBSSH2_SFTP * sftp = (LIBSSH2_SFTP *)m_fs->acquireSession(lock).sftpSession();
+    if (!sftp) return;
 
     // Create file information structure
     m_fileInfo = (void *)new LIBSSH2_SFTP_ATTRIBUTES;
 
     // Get file info
-    if (libssh2_sftp_stat_ex((LIBSSH2_SFTP *)m_fs->m_sftpSession, m_path.c_str(), m_path.length(), LIBSSH2_SFTP_STAT, (LIBSSH2_SFTP_ATTRIBUTES *)m_fileInfo) != 0)
+    if (libssh2_sftp_stat_ex(sftp, m_path.c_str(), m_path.length(), LIBSSH2_SFTP_STAT, (LIBSSH2_SFTP_ATTRIBUTES *)m_fileInfo) != 0)
     {
         // Error!
         delete (LIBSSH2_SFTP_ATTRIBUTES *)m_fileInfo;
@@ -660,18 +701,19 @@ void SshFileHandle::readLinkInfo() const
     // Check if file info has already been read
     if (m_linkInfo) return;
 
-    // Check handle
-    if (!m_fs->m_session) return;
+    // Use attributes from a directory listing
+    if (readCachedInfo()) return;
 
-    // Initialize SFTP sub-protocol
-    m_fs->initSftp();
-    if (!m_fs->m_sftpSession) return;
+    // Get session
+    std::unique_lock<std::recursive_mutex> lock;
+    LIBSSH2_SFTP * sftp = (LIBSSH2_SFTP *)m_fs->acquireSession(lock).sftpSession();
+    if (!sftp) return;
 
     // Create file information structure
     m_linkInfo = (void *)new LIBSSH2_SFTP_ATTRIBUTES;
 
     // Get file info
-    if (libssh2_sftp_stat_ex((LIBSSH2_SFTP *)m_fs->m_sftpSession, m_path.c_str(), m_path.length(), LIBSSH2_SFTP_LSTAT, (LIBSSH2_SFTP_ATTRIBUTES *)m_fileInfo) != 0)
+    if (libssh2_sftp_stat_ex(sftp, m_path.c_str(), m_path.length(), LIBSSH2_SFTP_LSTAT, (LIBSSH2_SFTP_ATTRIBUTES *)m_linkInfo) != 0)
     {
         // Error!
         delete (LIBSSH2_SFTP_ATTRIBUTES *)m_linkInfo;
@@ -679,5 +721,26 @@ void SshFileHandle::readLinkInfo() const
     }
 }
 
+bool SshFileHandle::readCachedInfo() const
+{
+    // Get attributes from a directory listing
+    LIBSSH2_SFTP_ATTRIBUTES attrs;
+    if (!m_fs->takeCachedAttributes(m_path, attrs)) return false;
+
+    // Directory listings do not resolve links
+    if (!m_linkInfo)
+    {
+        m_linkInfo = (void *)new LIBSSH2_SFTP_ATTRIBUTES(attrs);
+    }
+
+    // For anything but a link, the attributes are the same when resolved
+    if (!m_fileInfo && (attrs.permissions & LIBSSH2_SFTP_S_IFMT) != LIBSSH2_SFTP_S_IFLNK)
+    {
+        m_fileInfo = (void *)new LIBSSH2_SFTP_ATTRIBUTES(attrs);
+    }
+
+    return true;
+}
+
 
 } // namespace cppfs
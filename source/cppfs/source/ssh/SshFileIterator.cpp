@@ -3,7 +3,10 @@
 
 #include <libssh2.h>
 
+#include <cppfs/FilePath.h>
+
 #include <cppfs/ssh/SshFileSystem.h>
+#include <cppfs/ssh/SshSession.h>
 
 
 namespace cppfs
@@ -13,20 +16,19 @@ namespace cppfs
 SshFileIterator::SshFileIterator(std::shared_ptr<SshFileSystem> fs, const std::string & path)
 : m_fs(fs)
 , m_path(path)
+, m_session(nullptr)
 , m_dir(nullptr)
 , m_index(-1)
 {
-    // Check handle
-    if (!m_fs->m_session) return;
-
-    // Initialize SFTP sub-protocol
-    m_fs->initSftp();
+    // Get session
+    std::unique_lock<std::recursive_mutex> lock;
+    m_session = &m_fs->acquireSession(lock);
 
-    // Check handle
-    if (!m_fs->m_sftpSession) return;
+    LIBSSH2_SFTP * sftp = (LIBSSH2_SFTP *)m_session->sftpSession();
+    if (!sftp) return;
 
     // Open directory
-    m_dir = libssh2_sftp_opendir((LIBSSH2_SFTP *)m_fs->m_sftpSession, m_path.c_str());
+    m_dir = libssh2_sftp_opendir(sftp, m_path.c_str());
 
     // Read first directory entry
     readNextEntry();
@@ -36,6 +38,7 @@ SshFileIterator::~SshFileIterator()
 {
     if (m_dir)
     {
+        std::lock_guard<std::recursive_mutex> lock(m_session->mutex());
         libssh2_sftp_closedir(m_dir);
     }
 }
@@ -82,11 +85,34 @@ void SshFileIterator::next()
     readNextEntry();
 }
 
+bool SshFileIterator::entryInfo(EntryInfo & info) const
+{
+    // Check if the listing has provided the attributes
+    unsigned long required = LIBSSH2_SFTP_ATTR_PERMISSIONS | LIBSSH2_SFTP_ATTR_SIZE | LIBSSH2_SFTP_ATTR_ACMODTIME | LIBSSH2_SFTP_ATTR_UIDGID;
+    if (!valid() || (m_attrs.flags & required) != required)
+    {
+        return false;
+    }
+
+    info.isDirectory      = LIBSSH2_SFTP_S_ISDIR(m_attrs.permissions);
+    info.isSymbolicLink   = LIBSSH2_SFTP_S_ISLNK(m_attrs.permissions);
+    info.size             = static_cast<unsigned int>(m_attrs.filesize);
+    info.modificationTime = static_cast<unsigned int>(m_attrs.mtime);
+    info.permissions      = static_cast<unsigned long>(m_attrs.permissions & 07777);
+    info.userId           = static_cast<unsigned int>(m_attrs.uid);
+    info.groupId          = static_cast<unsigned int>(m_attrs.gid);
+
+    return true;
+}
+
 void SshFileIterator::readNextEntry()
 {
     // Check directory handle
     if (!m_dir) return;
 
+    // Lock session
+    std::lock_guard<std::recursive_mutex> lock(m_session->mutex());
+
     // Read next entry
     char name[512];
     char longName[512];
@@ -114,6 +140,12 @@ void SshFileIterator::readNextEntry()
 
         m_filename = name;
     }
+
+    // Keep attributes for handles that are opened on the entry
+    if (!m_filename.empty() && (m_attrs.flags & LIBSSH2_SFTP_ATTR_PERMISSIONS))
+    {
+        m_fs->cacheAttributes(FilePath(m_path).resolve(m_filename).fullPath(), m_attrs);
+    }
 }
 
 
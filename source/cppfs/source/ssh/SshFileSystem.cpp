@@ -1,60 +1,184 @@
 
 #include <cppfs/ssh/SshFileSystem.h>
 
-#ifdef WIN32
-    #include <winsock2.h>
-    #include <ws2tcpip.h>
-#else
-    #include <sys/socket.h>
-    #include <netinet/in.h>
-    #include <arpa/inet.h>
-    #include <netdb.h>
-    #include <unistd.h>
-#endif
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
 
 #include <libssh2.h>
 #include <libssh2_sftp.h>
 
 #include <cppfs/FileHandle.h>
+#include <cppfs/FilePath.h>
+#include <cppfs/Tree.h>
+#include <cppfs/LoginCredentials.h>
 #include <cppfs/AbstractFileWatcherBackend.h>
+#include <cppfs/PollingFileWatcher.h>
 #include <cppfs/ssh/SshFileHandle.h>
+#include <cppfs/ssh/SshSession.h>
+#include <cppfs/ssh/SshEventLoop.h>
+
+
+namespace
+{
+
+
+// Size of a single SFTP read request issued by libssh2
+const size_t sftpReadSize = 30000;
+
+// Size of a single SFTP write request issued by libssh2
+const size_t sftpWriteSize = 30000;
+
+// Maximum number of entries in the attribute cache
+const size_t maxCachedAttributes = 100000;
+
+// Maximum length of command lines that are executed on the remote host
+const size_t maxCommandLength = 32768;
+
+// Exit status of the shell if a command has not been found
+const int commandNotFound = 127;
+
+// Parse output of sha1sum (lines of '<hash>  <path>', lines with special characters in the path start with a backslash)
+std::map<std::string, std::string> parseHashes(const std::string & output)
+{
+    std::map<std::string, std::string> hashes;
+
+    size_t pos = 0;
+    while (pos < output.size())
+    {
+        // Get next line
+        size_t end = output.find('\n', pos);
+        if (end == std::string::npos) end = output.size();
+
+        std::string line = output.substr(pos, end - pos);
+        pos = end + 1;
+
+        // Check for escaped path
+        bool escaped = (!line.empty() && line[0] == '\\');
+        if (escaped) line.erase(0, 1);
+
+        // Split into hash and path
+        if (line.size() < 43) continue;
+
+        std::string hash = line.substr(0, 40);
+        std::string path = line.substr(42);
+
+        // Unescape path
+        if (escaped)
+        {
+            std::string unescaped;
+
+            for (size_t i = 0; i < path.size(); i++)
+            {
+                if (path[i] == '\\' && i + 1 < path.size())
+                {
+                    char c = path[++i];
+                         if (c == 'n') unescaped += '\n';
+                    else if (c == 'r') unescaped += '\r';
+                    else               unescaped += c;
+                }
+                else
+                {
+                    unescaped += path[i];
+                }
+            }
+
+            path = unescaped;
+        }
+
+        hashes[path] = hash;
+    }
+
+    return hashes;
+}
+
+// Convert POSIX permission bits into FilePermissions
+unsigned int convertPermissions(unsigned long mode)
+{
+    return (unsigned int)( ((mode >> 6) & 7) << 8 | ((mode >> 3) & 7) << 4 | (mode & 7) );
+}
+
+// Read numerical option (keeps the current value if the option is not set or not a valid number)
+void readOption(const cppfs::LoginCredentials & options, const std::string & name, unsigned int minValue, unsigned int & value)
+{
+    if (!options.isSet(name)) return;
+
+    const std::string & str = options.value(name);
+    char * end = nullptr;
+
+    errno = 0;
+    long number = std::strtol(str.c_str(), &end, 10);
+
+    if (str.empty() || *end != '\0' || errno == ERANGE || number > UINT_MAX) return;
+
+    value = std::max(number, static_cast<long>(minValue));
+}
+
+
+} // namespace
 
 
 namespace cppfs
 {
 
 
-SshFileSystem::SshFileSystem(const std::string & host, int port, const std::string & username, const std::string & password, const std::string & publicKey, const std::string & privateKey)
+SshFileSystem::SshFileSystem(const std::string & host, int port, const std::string & username, const std::string & password, const std::string & publicKey, const std::string & privateKey, const LoginCredentials * options)
 : m_host(host)
 , m_port(port)
 , m_username(username)
 , m_password(password)
 , m_publicKey(publicKey)
 , m_privateKey(privateKey)
-, m_socket(0)
-, m_session(nullptr)
-, m_sftpSession(nullptr)
+, m_readAhead(16)
+, m_writeAhead(16)
+, m_syncMode(SyncPerFile)
+, m_maxSessions(1)
+, m_cacheTime(2000)
+, m_channels(8)
+, m_compression(false)
+, m_windowSize(0)
+, m_remoteExec(true)
+, m_remoteHash(true)
+, m_remoteFind(true)
+, m_nextSession(0)
+, m_connecting(0)
 {
-    connect();
+    applyOptions(options);
+
+    // Open first session
+    m_sessions.push_back(createSession());
 }
 
-SshFileSystem::SshFileSystem(std::string && host, int port, std::string && username, std::string && password, std::string && publicKey, std::string && privateKey)
+SshFileSystem::SshFileSystem(std::string && host, int port, std::string && username, std::string && password, std::string && publicKey, std::string && privateKey, const LoginCredentials * options)
 : m_host(std::move(host))
 , m_port(std::move(port))
 , m_username(std::move(username))
 , m_password(std::move(password))
 , m_publicKey(std::move(publicKey))
 , m_privateKey(std::move(privateKey))
-, m_socket(0)
-, m_session(nullptr)
-, m_sftpSession(nullptr)
+, m_readAhead(16)
+, m_writeAhead(16)
+, m_syncMode(SyncPerFile)
+, m_maxSessions(1)
+, m_cacheTime(2000)
+, m_channels(8)
+, m_compression(false)
+, m_windowSize(0)
+, m_remoteExec(true)
+, m_remoteHash(true)
+, m_remoteFind(true)
+, m_nextSession(0)
+, m_connecting(0)
 {
-    connect();
+    applyOptions(options);
+
+    // Open first session
+    m_sessions.push_back(createSession());
 }
 
 SshFileSystem::~SshFileSystem()
 {
-    disconnect();
 }
 
 FileHandle SshFileSystem::open(const std::string & path)
@@ -71,173 +195,475 @@ FileHandle SshFileSystem::open(std::string && path)
     );
 }
 
-std::unique_ptr<AbstractFileWatcherBackend> SshFileSystem::createFileWatcher(FileWatcher & fileWatcher)
+std::unique_ptr<AbstractFileWatcherBackend> SshFileSystem::createFileWatcher(FileWatcher & fileWatcher, WatcherType)
+{
+    // Remote file systems can only be watched by polling
+    return std::unique_ptr<AbstractFileWatcherBackend>(
+            new PollingFileWatcher(&fileWatcher, shared_from_this())
+    );
+}
+
+std::vector<std::string> SshFileSystem::sha1(const std::vector<std::string> & paths)
+{
+    std::vector<std::string> hashes(paths.size());
+
+    // Check if hashes can be computed on the remote host
+    if (!m_remoteHash) return hashes;
+
+    // Hash files (the command fails for files that cannot be read, but still hashes the others)
+    std::string output;
+    int status = execute("sha1sum --", paths, &output);
+
+    // Stop using remote commands if there is no shell access or sha1sum is missing
+    if (status < 0 || status == commandNotFound)
+    {
+        m_remoteHash = false;
+        return hashes;
+    }
+
+    // Get hashes
+    auto results = parseHashes(output);
+
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        auto it = results.find(paths[i]);
+        if (it != results.end())
+        {
+            hashes[i] = it->second;
+        }
+    }
+
+    return hashes;
+}
+
+std::unique_ptr<Tree> SshFileSystem::readTree(const std::string & path, const std::string & treePath)
+{
+    // Check if trees can be listed on the remote host
+    if (!m_remoteFind || !m_remoteExec) return nullptr;
+
+    // List tree with GNU find (links are followed like in FileHandle::readTree).
+    // Each entry consists of the fields type, size, access time, modification time,
+    // permissions, user, group and relative path, each terminated by a null character.
+    std::string cmd = "find -L " + quote(path) + " -printf '%y\\0%s\\0%A@\\0%T@\\0%m\\0%U\\0%G\\0%P\\0'";
+
+    std::unique_ptr<Tree>         root;
+    std::map<std::string, Tree *> dirs;
+    std::vector<std::string>      fields;
+    std::string                   field;
+
+    // Read entries while the output arrives
+    auto parse = [&] (const char * data, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            if (data[i] != '\0')
+            {
+                field += data[i];
+                continue;
+            }
+
+            fields.push_back(std::move(field));
+            field.clear();
+
+            if (fields.size() < 8) continue;
+
+            // Skip broken links and special files (FIFOs, sockets and devices),
+            // so that only regular files are hashed
+            const std::string & type = fields[0];
+            const std::string & name = fields[7];
+
+            if (type != "f" && type != "d")
+            {
+                fields.clear();
+                continue;
+            }
+
+            // Get parent directory
+            Tree * parent = nullptr;
+
+            if (!name.empty())
+            {
+                size_t pos = name.rfind('/');
+                auto it = dirs.find(pos == std::string::npos ? std::string() : name.substr(0, pos));
+
+                if (it == dirs.end())
+                {
+                    fields.clear();
+                    continue;
+                }
+
+                parent = it->second;
+            }
+
+            // Create entry
+            std::unique_ptr<Tree> tree(new Tree);
+            tree->setPath(name.empty() ? treePath : (treePath.empty() ? name : treePath + "/" + name));
+            tree->setFileName(FilePath(name.empty() ? path : name).fileName());
+            tree->setDirectory(type == "d");
+            tree->setSize(type == "f" ? std::strtoul(fields[1].c_str(), nullptr, 10) : 0);
+            tree->setAccessTime(std::strtoul(fields[2].c_str(), nullptr, 10));
+            tree->setModificationTime(std::strtoul(fields[3].c_str(), nullptr, 10));
+            tree->setPermissions(convertPermissions(std::strtoul(fields[4].c_str(), nullptr, 8)));
+            tree->setUserId(std::strtoul(fields[5].c_str(), nullptr, 10));
+            tree->setGroupId(std::strtoul(fields[6].c_str(), nullptr, 10));
+
+            if (type == "d")
+            {
+                dirs[name] = tree.get();
+            }
+
+            // Add entry to tree
+            if (parent)
+            {
+                parent->add(std::move(tree));
+            }
+            else
+            {
+                root = std::move(tree);
+            }
+
+            fields.clear();
+        }
+    };
+
+    int status = -1;
+
+    {
+        std::unique_lock<std::recursive_mutex> lock;
+        status = acquireSession(lock).execute(cmd, parse);
+    }
+
+    // Fall back to visiting each directory if the command is not supported.
+    // Errors on single entries (e.g., missing permissions) are reported by
+    // find with status 1, but do not prevent listing the others.
+    if (!root && status != 0)
+    {
+        m_remoteFind = false;
+    }
+
+    if (status < 0)
+    {
+        m_remoteExec = false;
+    }
+
+    return root;
+}
+
+SshFileSystem::SyncMode SshFileSystem::syncMode() const
 {
-    return nullptr;
+    return m_syncMode;
 }
 
-void SshFileSystem::connect()
+void SshFileSystem::setSyncMode(SyncMode mode)
 {
-#ifdef WIN32
-    // Initialize winsock
-    WSADATA wsadata;
-    WSAStartup(MAKEWORD(2,0), &wsadata);
-#endif
+    m_syncMode = mode;
+}
 
-    // Close connection if it is already open
-    disconnect();
+bool SshFileSystem::sync()
+{
+    return execute("sync") == 0;
+}
 
-    // Initialize libssh2
-    libssh2_init(0);
+int SshFileSystem::execute(const std::string & command, std::string * output)
+{
+    // Check if commands can be executed on the remote host
+    if (!m_remoteExec) return -1;
 
-    // Lookup host name
-    struct addrinfo hints;
-    memset(&hints, 0, sizeof hints);
-    hints.ai_family   = AF_UNSPEC;
-    hints.ai_socktype = SOCK_STREAM;
+    int status = -1;
 
-    struct addrinfo * addrInfo = nullptr;
-    if ((getaddrinfo(m_host.c_str(), std::to_string(m_port).c_str(), &hints, &addrInfo)) != 0)
     {
-        // Error!
-        return;
+        std::unique_lock<std::recursive_mutex> lock;
+        status = acquireSession(lock).execute(command, output);
     }
 
-    // Try to connect
-    m_socket = -1;
-    for (struct addrinfo * address = addrInfo; address != nullptr; address = address->ai_next)
+    // Stop executing commands if the server does not allow it (e.g., SFTP only),
+    // so that callers fall back to SFTP right away
+    if (status < 0)
+    {
+        m_remoteExec = false;
+    }
+
+    return status;
+}
+
+int SshFileSystem::execute(const std::string & command, const std::vector<std::string> & args, std::string * output)
+{
+    int result = 0;
+
+    // Execute commands in batches, so that command lines do not get too long
+    size_t first = 0;
+
+    while (first < args.size())
     {
-        // Create socket
-        if ((m_socket = socket(address->ai_family, address->ai_socktype, address->ai_protocol)) == -1)
+        // Compose command
+        std::string cmd = command;
+
+        size_t last = first;
+        while (last < args.size())
         {
-            // Error!
-            continue;
+            std::string arg = " " + quote(args[last]);
+            if (last > first && cmd.size() + arg.size() > maxCommandLength) break;
+
+            cmd += arg;
+            last++;
         }
 
-        // Connect
-        if (::connect(m_socket, address->ai_addr, address->ai_addrlen) == -1)
+        // Execute command
+        int status = execute(cmd, output);
+
+        // Stop if the command cannot be executed at all
+        if (status < 0 || status == commandNotFound)
         {
-            // Error!
-            #ifdef WIN32
-                _close(m_socket);
-            #else
-                close(m_socket);
-            #endif
-            continue;
+            return status;
         }
+
+        result = std::max(result, status);
+        first = last;
+    }
+
+    return result;
+}
+
+bool SshFileSystem::removeAll(const std::vector<std::string> & paths)
+{
+    int status = execute("rm -rf --", paths);
+
+    for (const auto & path : paths)
+    {
+        invalidateAttributes(path);
+    }
+
+    return status == 0;
+}
+
+bool SshFileSystem::isConnected()
+{
+    // Check a session that is not busy, if there is one
+    std::unique_lock<std::recursive_mutex> lock;
+    return acquireSession(lock).isConnected();
+}
+
+SshEventLoop & SshFileSystem::eventLoop()
+{
+    std::lock_guard<std::mutex> lock(m_eventLoopMutex);
+
+    // Create event loop on first use
+    if (!m_eventLoop)
+    {
+        m_eventLoop.reset(new SshEventLoop(*this, createSession(), m_channels));
+    }
+
+    return *m_eventLoop;
+}
+
+size_t SshFileSystem::sessionCount() const
+{
+    std::lock_guard<std::mutex> lock(m_sessionsMutex);
+
+    return m_sessions.size();
+}
+
+std::string SshFileSystem::quote(const std::string & arg)
+{
+    std::string quoted = "'";
+
+    for (char c : arg)
+    {
+        // A single quote ends the quoted string, so it is added as an escaped character
+        if (c == '\'') quoted += "'\\''";
+        else            quoted += c;
     }
 
-    // Clean up
-    freeaddrinfo(addrInfo);
+    return quoted + "'";
+}
 
-    // Check if connection has been successfull
-    if (m_socket == -1)
+void SshFileSystem::applyOptions(const LoginCredentials * options)
+{
+    if (!options) return;
+
+    readOption(*options, "readAhead",  1, m_readAhead);
+    readOption(*options, "writeAhead", 1, m_writeAhead);
+
+    if (options->isSet("sync"))
     {
-        return;
+        const std::string & mode = options->value("sync");
+
+             if (mode == "file")  m_syncMode = SyncPerFile;
+        else if (mode == "batch") m_syncMode = SyncPerBatch;
+        else if (mode == "never") m_syncMode = SyncNever;
     }
 
-    // Create libssh2 handle
-    m_session = libssh2_session_init();
-    if (m_session)
+    readOption(*options, "sessions",           1, m_maxSessions);
+    readOption(*options, "attributeCacheTime", 0, m_cacheTime);
+    readOption(*options, "asyncChannels",      1, m_channels);
+
+    if (options->isSet("ciphers"))     m_ciphers     = options->value("ciphers");
+    if (options->isSet("macs"))        m_macs        = options->value("macs");
+    if (options->isSet("kex"))         m_kex         = options->value("kex");
+    if (options->isSet("hostKeys"))    m_hostKeys    = options->value("hostKeys");
+    if (options->isSet("compression")) m_compression = (options->value("compression") == "true");
+
+    readOption(*options, "windowSize", 0, m_windowSize);
+}
+
+std::unique_ptr<SshSession> SshFileSystem::createSession() const
+{
+    SshSession::Settings settings;
+    settings.ciphers     = m_ciphers;
+    settings.macs        = m_macs;
+    settings.kex         = m_kex;
+    settings.hostKeys    = m_hostKeys;
+    settings.compression = m_compression;
+    settings.windowSize  = m_windowSize;
+
+    return std::unique_ptr<SshSession>(
+        new SshSession(m_host, m_port, m_username, m_password, m_publicKey, m_privateKey, settings)
+    );
+}
+
+size_t SshFileSystem::readBufferSize() const
+{
+    return m_readAhead * sftpReadSize;
+}
+
+size_t SshFileSystem::writeBufferSize() const
+{
+    return m_writeAhead * sftpWriteSize;
+}
+
+SshSession & SshFileSystem::acquireSession(std::unique_lock<std::recursive_mutex> & lock)
+{
+    SshSession * session = nullptr;
+    bool         connect = false;
+
     {
-        // Open session
-        int res = libssh2_session_handshake((LIBSSH2_SESSION *)m_session, m_socket);
-        /*
-        if (res == LIBSSH2_ERROR_SOCKET_NONE)       std::cout << "LIBSSH2_ERROR_SOCKET_NONE" << std::endl;
-        if (res == LIBSSH2_ERROR_BANNER_SEND)       std::cout << "LIBSSH2_ERROR_BANNER_SEND" << std::endl;
-        if (res == LIBSSH2_ERROR_KEX_FAILURE)       std::cout << "LIBSSH2_ERROR_KEX_FAILURE" << std::endl;
-        if (res == LIBSSH2_ERROR_SOCKET_SEND)       std::cout << "LIBSSH2_ERROR_SOCKET_SEND" << std::endl;
-        if (res == LIBSSH2_ERROR_SOCKET_DISCONNECT) std::cout << "LIBSSH2_ERROR_SOCKET_DISCONNECT" << std::endl;
-        if (res == LIBSSH2_ERROR_PROTO)             std::cout << "LIBSSH2_ERROR_PROTO" << std::endl;
-        if (res == LIBSSH2_ERROR_EAGAIN)            std::cout << "LIBSSH2_ERROR_EAGAIN" << std::endl;
-        */
+        std::lock_guard<std::mutex> sessionsLock(m_sessionsMutex);
 
-        if (res == 0)
+        // Use a session that is not busy
+        for (size_t i = 0; i < m_sessions.size(); i++)
         {
-            // Get fingerprint
-            std::string fingerprint(libssh2_hostkey_hash((LIBSSH2_SESSION *)m_session, LIBSSH2_HOSTKEY_HASH_SHA1));
-
-            // Try public key authentication first
-            int connect = libssh2_userauth_publickey_fromfile(
-                (LIBSSH2_SESSION *)m_session, m_username.c_str(),
-                m_publicKey.c_str(),
-                m_privateKey.c_str(),
-                m_password.c_str()
-            );
-
-            // Try username/password second
-            if (connect != 0)
+            size_t index = (m_nextSession + i) % m_sessions.size();
+
+            std::unique_lock<std::recursive_mutex> sessionLock(m_sessions[index]->mutex(), std::try_to_lock);
+            if (sessionLock.owns_lock())
             {
-                connect = libssh2_userauth_password((LIBSSH2_SESSION *)m_session, m_username.c_str(), m_password.c_str());
+                m_nextSession = (index + 1) % m_sessions.size();
+                lock = std::move(sessionLock);
+                return *m_sessions[index];
             }
+        }
+
+        // Reserve another session (it is opened without holding the lock,
+        // so that other threads can use the existing sessions meanwhile)
+        if (m_sessions.size() + m_connecting < m_maxSessions)
+        {
+            m_connecting++;
+            connect = true;
+        }
+
+        // Wait for the next session in turn
+        else
+        {
+            session = m_sessions[m_nextSession % m_sessions.size()].get();
+            m_nextSession = (m_nextSession + 1) % m_sessions.size();
+        }
+    }
+
+    // Open another session, unless the host refuses it
+    if (connect)
+    {
+        std::unique_ptr<SshSession> newSession = createSession();
+
+        std::unique_lock<std::recursive_mutex> sessionLock;
+        if (newSession->session())
+        {
+            sessionLock = std::unique_lock<std::recursive_mutex>(newSession->mutex());
+        }
+
+        std::lock_guard<std::mutex> sessionsLock(m_sessionsMutex);
+        m_connecting--;
+
+        if (sessionLock.owns_lock())
+        {
+            m_sessions.push_back(std::move(newSession));
+            lock = std::move(sessionLock);
+            return *m_sessions.back();
+        }
+
+        // Wait for the next session in turn
+        session = m_sessions[m_nextSession % m_sessions.size()].get();
+        m_nextSession = (m_nextSession + 1) % m_sessions.size();
+    }
+
+    lock = std::unique_lock<std::recursive_mutex>(session->mutex());
+    return *session;
+}
+
+void SshFileSystem::cacheAttributes(const std::string & path, const LIBSSH2_SFTP_ATTRIBUTES & attrs)
+{
+    // Check if the cache is enabled
+    if (m_cacheTime == 0) return;
+
+    std::lock_guard<std::mutex> lock(m_attrCacheMutex);
 
-            // Have we connected successfully?
-            if (connect == 0)
+    auto now = std::chrono::steady_clock::now();
+
+    // Remove outdated entries if the cache is full
+    if (m_attrCache.size() >= maxCachedAttributes)
+    {
+        for (auto it = m_attrCache.begin(); it != m_attrCache.end(); )
+        {
+            if (now - it->second.first > std::chrono::milliseconds(m_cacheTime))
             {
-                // Set SSH mode to blocking
-                libssh2_session_set_blocking((LIBSSH2_SESSION *)m_session, 1);
+                it = m_attrCache.erase(it);
             }
             else
             {
-                // ERROR, could not connect
-                disconnect();
+                ++it;
             }
         }
+
+        if (m_attrCache.size() >= maxCachedAttributes) return;
     }
+
+    // Add entry
+    m_attrCache[path] = std::make_pair(now, attrs);
 }
 
-void SshFileSystem::disconnect()
+bool SshFileSystem::takeCachedAttributes(const std::string & path, LIBSSH2_SFTP_ATTRIBUTES & attrs)
 {
-    // Check if session is already closed
-    if (!m_session) return;
+    std::lock_guard<std::mutex> lock(m_attrCacheMutex);
 
-    // Close SFTP session
-    if (m_sftpSession)
-    {
-        libssh2_sftp_shutdown((LIBSSH2_SFTP *)m_sftpSession);
-    }
+    // Find entry
+    auto it = m_attrCache.find(path);
+    if (it == m_attrCache.end()) return false;
 
-    // Close SSH session
-    libssh2_session_disconnect((LIBSSH2_SESSION *)m_session, "done");
-    libssh2_session_free      ((LIBSSH2_SESSION *)m_session);
-
-    // Close socket
-    if (m_socket != 0)
+    // Get attributes, unless they are outdated
+    bool valid = (std::chrono::steady_clock::now() - it->second.first <= std::chrono::milliseconds(m_cacheTime));
+    if (valid)
     {
-        #ifdef WIN32
-            closesocket(m_socket);
-        #else
-            ::close(m_socket);
-        #endif
+        attrs = it->second.second;
     }
 
-    // Reset state
-    m_socket      = 0;
-    m_session     = nullptr;
-    m_sftpSession = nullptr;
+    // Remove entry, later handles will query the server again
+    m_attrCache.erase(it);
+    return valid;
 }
 
-void SshFileSystem::initSftp()
+void SshFileSystem::invalidateAttributes(const std::string & path)
 {
-    // Check if SFTP subprotocol has already been initialize
-    if (m_sftpSession) return;
-
-    // Open SFTP session
-    m_sftpSession = libssh2_sftp_init((LIBSSH2_SESSION *)m_session);
-}
+    std::lock_guard<std::mutex> lock(m_attrCacheMutex);
 
-void SshFileSystem::checkError()
-{
-    // Get SSH error message
-    char * errorMsg;
-    int    len = 1024;
-    libssh2_session_last_error((LIBSSH2_SESSION *)m_session, &errorMsg, &len, 0);
+    // Remove entry for the path itself
+    m_attrCache.erase(path);
 
-    // [TODO] Log error
-//  std::cout << "SSH ERROR: " << errorMsg << "\n";
+    // Remove entries below the path
+    std::string prefix = path + "/";
 
-    // To recover from errors, it seems to be necessary to reconnect :(
-    connect();
+    for (auto it = m_attrCache.lower_bound(prefix); it != m_attrCache.end() && it->first.compare(0, prefix.size(), prefix) == 0; )
+    {
+        it = m_attrCache.erase(it);
+    }
 }
 
 
@@ -9,6 +9,7 @@
 #include <libssh2_sftp.h>
 
 #include <cppfs/ssh/SshFileSystem.h>
+#include <cppfs/ssh/SshSession.h>
 
 
 #ifdef max
@@ -23,21 +24,20 @@ namespace cppfs
 SshInputStreamBuffer::SshInputStreamBuffer(std::shared_ptr<SshFileSystem> fs, const std::string & path, std::ios_base::openmode, size_t bufferSize, size_t putbackSize)
 : m_fs(fs)
 , m_path(path)
+, m_session(nullptr)
 , m_file(nullptr)
 , m_putbackSize(std::max(putbackSize, (size_t)1))
 , m_buffer(std::max(bufferSize, m_putbackSize) + m_putbackSize)
 {
-    // Check handle
-    if (!m_fs->m_session) return;
+    // Get session
+    std::unique_lock<std::recursive_mutex> lock;
+    m_session = &m_fs->acquireSession(lock);
 
-    // Initialize SFTP sub-protocol
-    m_fs->initSftp();
-
-    // Check handle
-    if (!m_fs->m_sftpSession) return;
+    LIBSSH2_SFTP * sftp = (LIBSSH2_SFTP *)m_session->sftpSession();
+    if (!sftp) return;
 
     // Open file
-    m_file = (void *)libssh2_sftp_open((LIBSSH2_SFTP *)m_fs->m_sftpSession, m_path.c_str(), LIBSSH2_FXF_READ, 0);
+    m_file = (void *)libssh2_sftp_open(sftp, m_path.c_str(), LIBSSH2_FXF_READ, 0);
 
     if (m_file)
     {
@@ -45,18 +45,13 @@ SshInputStreamBuffer::SshInputStreamBuffer(std::shared_ptr<SshFileSystem> fs, co
         char * end = &m_buffer.front() + m_buffer.size();
         setg(end, end, end);
     }
-
-    else
-    {
-        // Error, close file
-        libssh2_sftp_close((LIBSSH2_SFTP_HANDLE *)m_file);
-    }
 }
 
 SshInputStreamBuffer::~SshInputStreamBuffer()
 {
     if (m_file)
     {
+        std::lock_guard<std::recursive_mutex> lock(m_session->mutex());
         libssh2_sftp_close((LIBSSH2_SFTP_HANDLE *)m_file);
     }
 }
@@ -87,11 +82,13 @@ std::streambuf::int_type SshInputStreamBuffer::underflow()
     }
 
     // Refill buffer
+    std::lock_guard<std::recursive_mutex> lock(m_session->mutex());
+
     size_t size = m_buffer.size() - (start - base);
     ssize_t n = libssh2_sftp_read((LIBSSH2_SFTP_HANDLE *)m_file, start, size);
 
-    // EOF
-    if (n == 0)
+    // EOF or error
+    if (n <= 0)
     {
         return traits_type::eof();
     }
@@ -112,6 +109,7 @@ SshInputStreamBuffer::pos_type SshInputStreamBuffer::seekoff(off_type off, std::
 
     else if (way == std::ios_base::end)
     {
+        std::lock_guard<std::recursive_mutex> lock(m_session->mutex());
         LIBSSH2_SFTP_ATTRIBUTES attrs;
 
         if (libssh2_sftp_fstat_ex((LIBSSH2_SFTP_HANDLE *)m_file, &attrs, 0) == 0)
@@ -123,6 +121,7 @@ SshInputStreamBuffer::pos_type SshInputStreamBuffer::seekoff(off_type off, std::
 
     else if (way == std::ios_base::cur)
     {
+        std::lock_guard<std::recursive_mutex> lock(m_session->mutex());
         pos_type pos = (pos_type)libssh2_sftp_tell64((LIBSSH2_SFTP_HANDLE *)m_file);
         pos += off - (egptr() - gptr());
 
@@ -141,6 +140,7 @@ SshInputStreamBuffer::pos_type SshInputStreamBuffer::seekpos(pos_type pos, std::
     }
 
     // Set file position
+    std::lock_guard<std::recursive_mutex> lock(m_session->mutex());
     libssh2_sftp_seek64((LIBSSH2_SFTP_HANDLE *)m_file, (libssh2_uint64_t)pos);
 
     // Reset read buffer
@@ -8,6 +8,7 @@
 #include <libssh2_sftp.h>
 
 #include <cppfs/ssh/SshFileSystem.h>
+#include <cppfs/ssh/SshSession.h>
 
 
 #ifdef max
@@ -22,17 +23,17 @@ namespace cppfs
 SshOutputStreamBuffer::SshOutputStreamBuffer(std::shared_ptr<SshFileSystem> fs, const std::string & path, std::ios_base::openmode mode, size_t bufferSize)
 : m_fs(fs)
 , m_path(path)
+, m_session(nullptr)
 , m_file(nullptr)
+, m_sync(fs->syncMode() == SshFileSystem::SyncPerFile)
 , m_buffer(std::max(bufferSize, (size_t)1))
 {
-    // Check handle
-    if (!m_fs->m_session) return;
+    // Get session
+    std::unique_lock<std::recursive_mutex> lock;
+    m_session = &m_fs->acquireSession(lock);
 
-    // Initialize SFTP sub-protocol
-    m_fs->initSftp();
-
-    // Check handle
-    if (!m_fs->m_sftpSession) return;
+    LIBSSH2_SFTP * sftp = (LIBSSH2_SFTP *)m_session->sftpSession();
+    if (!sftp) return;
 
     // Set opening flags
     unsigned long flags = LIBSSH2_FXF_WRITE | LIBSSH2_FXF_CREAT;
@@ -40,7 +41,7 @@ SshOutputStreamBuffer::SshOutputStreamBuffer(std::shared_ptr<SshFileSystem> fs,
     if (mode & std::ios::trunc) flags |= LIBSSH2_FXF_TRUNC;
 
     // Open file
-    m_file = (void *)libssh2_sftp_open((LIBSSH2_SFTP *)m_fs->m_sftpSession, m_path.c_str(), flags, 0);
+    m_file = (void *)libssh2_sftp_open(sftp, m_path.c_str(), flags, 0);
 
     if (m_file)
     {
@@ -56,11 +57,17 @@ SshOutputStreamBuffer::~SshOutputStreamBuffer()
     // Close file
     if (m_file)
     {
+        std::lock_guard<std::recursive_mutex> lock(m_session->mutex());
+
         // Flush buffer
         sync();
 
-        // Sync file
-        libssh2_sftp_fsync((LIBSSH2_SFTP_HANDLE *)m_file);
+        // Sync file to disk
+        if (m_sync)
+        {
+            libssh2_sftp_fsync((LIBSSH2_SFTP_HANDLE *)m_file);
+        }
+
         libssh2_sftp_close((LIBSSH2_SFTP_HANDLE *)m_file);
     }
 }
@@ -93,44 +100,67 @@ std::streambuf::int_type SshOutputStreamBuffer::overflow(std::streambuf::int_typ
 
 int SshOutputStreamBuffer::sync()
 {
-    // Get size of data in the buffer
-    size_t size = pptr() - &m_buffer.front();
-    if (size > 0)
+    // Check file handle
+    if (!m_file)
     {
-        // Write to stream
-        auto res = libssh2_sftp_write((LIBSSH2_SFTP_HANDLE *)m_file, &m_buffer.front(), size);
+        return -1;
+    }
 
-        // Check for errors
-        switch (res)
-        {
-            case LIBSSH2_ERROR_ALLOC:
-                std::cout << "SSH error: LIBSSH2_ERROR_ALLOC" << std::endl;
-                break;
+    // Lock session
+    std::lock_guard<std::recursive_mutex> lock(m_session->mutex());
 
-            case LIBSSH2_ERROR_SOCKET_SEND:
-                std::cout << "SSH error: LIBSSH2_ERROR_SOCKET_SEND" << std::endl;
-                break;
+    // Get data in the buffer
+    const char * data = &m_buffer.front();
+    size_t       size = pptr() - data;
 
-            case LIBSSH2_ERROR_SOCKET_TIMEOUT:
-                std::cout << "SSH error: LIBSSH2_ERROR_SOCKET_TIMEOUT" << std::endl;
-                break;
+    // Write to stream (libssh2 can return before the entire buffer has been written)
+    int result = 0;
 
-            case LIBSSH2_ERROR_SFTP_PROTOCOL:
-                std::cout << "SSH error: LIBSSH2_ERROR_SFTP_PROTOCOL" << std::endl;
-                break;
+    while (size > 0)
+    {
+        auto res = libssh2_sftp_write((LIBSSH2_SFTP_HANDLE *)m_file, data, size);
 
-            default:
-                break;
+        // Check for errors
+        if (res < 0)
+        {
+            switch (res)
+            {
+                case LIBSSH2_ERROR_ALLOC:
+                    std::cout << "SSH error: LIBSSH2_ERROR_ALLOC" << std::endl;
+                    break;
+
+                case LIBSSH2_ERROR_SOCKET_SEND:
+                    std::cout << "SSH error: LIBSSH2_ERROR_SOCKET_SEND" << std::endl;
+                    break;
+
+                case LIBSSH2_ERROR_SOCKET_TIMEOUT:
+                    std::cout << "SSH error: LIBSSH2_ERROR_SOCKET_TIMEOUT" << std::endl;
+                    break;
+
+                case LIBSSH2_ERROR_SFTP_PROTOCOL:
+                    std::cout << "SSH error: LIBSSH2_ERROR_SFTP_PROTOCOL" << std::endl;
+                    break;
+
+                default:
+                    break;
+            }
+
+            result = -1;
+            break;
         }
 
-        // Reset write buffer
-        char * start = &m_buffer.front();
-        char * end   = &m_buffer.front() + m_buffer.size();
-        setp(start, end);
+        // Continue with the remaining data
+        data += res;
+        size -= res;
     }
 
+    // Reset write buffer
+    char * start = &m_buffer.front();
+    char * end   = &m_buffer.front() + m_buffer.size();
+    setp(start, end);
+
     // Done
-    return 0;
+    return result;
 }
 
 SshOutputStreamBuffer::pos_type SshOutputStreamBuffer::seekoff(off_type off, std::ios_base::seekdir way, std::ios_base::openmode which)
@@ -145,6 +175,7 @@ SshOutputStreamBuffer::pos_type SshOutputStreamBuffer::seekoff(off_type off, std
 
     else if (way == std::ios_base::end)
     {
+        std::lock_guard<std::recursive_mutex> lock(m_session->mutex());
         LIBSSH2_SFTP_ATTRIBUTES attrs;
 
         if (libssh2_sftp_fstat_ex((LIBSSH2_SFTP_HANDLE *)m_file, &attrs, 0) == 0)
@@ -156,6 +187,7 @@ SshOutputStreamBuffer::pos_type SshOutputStreamBuffer::seekoff(off_type off, std
 
     else if (way == std::ios_base::cur)
     {
+        std::lock_guard<std::recursive_mutex> lock(m_session->mutex());
         pos_type pos = (pos_type)libssh2_sftp_tell64((LIBSSH2_SFTP_HANDLE *)m_file);
         pos += off;
 
@@ -177,6 +209,7 @@ SshOutputStreamBuffer::pos_type SshOutputStreamBuffer::seekpos(pos_type pos, std
     }
 
     // Set file position
+    std::lock_guard<std::recursive_mutex> lock(m_session->mutex());
     libssh2_sftp_seek64((LIBSSH2_SFTP_HANDLE *)m_file, (libssh2_uint64_t)pos);
 
     // Reset write buffer
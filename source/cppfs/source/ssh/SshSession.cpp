@@ -0,0 +1,367 @@
+
+#include <cppfs/ssh/SshSession.h>
+
+#ifdef WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <netdb.h>
+    #include <unistd.h>
+#endif
+
+#include <cstring>
+
+#include <libssh2.h>
+#include <libssh2_sftp.h>
+
+
+namespace
+{
+
+
+// Set preferred methods (keeps the defaults of libssh2 if the list is empty or not supported at all)
+void setMethodPreference(LIBSSH2_SESSION * session, int method, const std::string & preference)
+{
+    if (!preference.empty())
+    {
+        libssh2_session_method_pref(session, method, preference.c_str());
+    }
+}
+
+
+} // namespace
+
+
+namespace cppfs
+{
+
+
+SshSession::SshSession(const std::string & host, int port, const std::string & username, const std::string & password, const std::string & publicKey, const std::string & privateKey, const Settings & settings)
+: m_host(host)
+, m_port(port)
+, m_username(username)
+, m_password(password)
+, m_publicKey(publicKey)
+, m_privateKey(privateKey)
+, m_settings(settings)
+, m_socket(0)
+, m_session(nullptr)
+, m_sftpSession(nullptr)
+{
+    connect();
+}
+
+SshSession::~SshSession()
+{
+    disconnect();
+}
+
+std::recursive_mutex & SshSession::mutex()
+{
+    return m_mutex;
+}
+
+int SshSession::socket() const
+{
+    return m_session ? m_socket : -1;
+}
+
+void SshSession::setBlocking(bool blocking)
+{
+    if (m_session)
+    {
+        libssh2_session_set_blocking((LIBSSH2_SESSION *)m_session, blocking ? 1 : 0);
+    }
+}
+
+void * SshSession::session() const
+{
+    return m_session;
+}
+
+void * SshSession::sftpSession()
+{
+    // Check handle
+    if (!m_session) return nullptr;
+
+    // Open SFTP session if it has not been initialized yet
+    if (!m_sftpSession)
+    {
+        m_sftpSession = openSftpChannel();
+    }
+
+    return m_sftpSession;
+}
+
+void * SshSession::openSftpChannel()
+{
+    // Check handle
+    if (!m_session) return nullptr;
+
+    // Open SFTP channel
+    LIBSSH2_SFTP * sftp = libssh2_sftp_init((LIBSSH2_SESSION *)m_session);
+    if (!sftp) return nullptr;
+
+    // Enlarge receive window, so that more data can be in flight on slow links
+    if (m_settings.windowSize > LIBSSH2_CHANNEL_WINDOW_DEFAULT)
+    {
+        libssh2_channel_receive_window_adjust2(
+            libssh2_sftp_get_channel(sftp),
+            m_settings.windowSize - LIBSSH2_CHANNEL_WINDOW_DEFAULT,
+            1, nullptr
+        );
+    }
+
+    return sftp;
+}
+
+bool SshSession::isConnected()
+{
+    // Check handle
+    if (!m_session) return false;
+
+    // Open SFTP session
+    LIBSSH2_SFTP * sftp = (LIBSSH2_SFTP *)sftpSession();
+    if (!sftp) return false;
+
+    // Send a request and wait for the answer
+    LIBSSH2_SFTP_ATTRIBUTES attrs;
+    return libssh2_sftp_stat_ex(sftp, ".", 1, LIBSSH2_SFTP_STAT, &attrs) == 0;
+}
+
+int SshSession::execute(const std::string & command, std::string * output)
+{
+    return execute(command, [output] (const char * data, size_t size)
+    {
+        if (output)
+        {
+            output->append(data, size);
+        }
+    });
+}
+
+int SshSession::execute(const std::string & command, const std::function<void (const char * data, size_t size)> & output)
+{
+    // Check handle
+    if (!m_session) return -1;
+
+    // Open channel
+    unsigned int windowSize = m_settings.windowSize > 0 ? m_settings.windowSize : LIBSSH2_CHANNEL_WINDOW_DEFAULT;
+
+    LIBSSH2_CHANNEL * channel = libssh2_channel_open_ex(
+        (LIBSSH2_SESSION *)m_session, "session", sizeof("session") - 1,
+        windowSize, LIBSSH2_CHANNEL_PACKET_DEFAULT, nullptr, 0
+    );
+    if (!channel)
+    {
+        return -1;
+    }
+
+    // Discard error output, so it cannot stall the channel
+    libssh2_channel_handle_extended_data2(channel, LIBSSH2_CHANNEL_EXTENDED_DATA_IGNORE);
+
+    // Execute command
+    if (libssh2_channel_exec(channel, command.c_str()) != 0)
+    {
+        libssh2_channel_free(channel);
+        return -1;
+    }
+
+    // Read output until the command has finished
+    char buffer[32768];
+    ssize_t size = 0;
+
+    while ((size = libssh2_channel_read(channel, buffer, sizeof(buffer))) > 0)
+    {
+        output(buffer, size);
+    }
+
+    // Close channel and get exit status
+    libssh2_channel_close(channel);
+    libssh2_channel_wait_closed(channel);
+
+    int status = (size == 0) ? libssh2_channel_get_exit_status(channel) : -1;
+    libssh2_channel_free(channel);
+
+    return status;
+}
+
+void SshSession::connect()
+{
+#ifdef WIN32
+    // Initialize winsock
+    WSADATA wsadata;
+    WSAStartup(MAKEWORD(2,0), &wsadata);
+#endif
+
+    // Close connection if it is already open
+    disconnect();
+
+    // Initialize libssh2
+    libssh2_init(0);
+
+    // Lookup host name
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo * addrInfo = nullptr;
+    if ((getaddrinfo(m_host.c_str(), std::to_string(m_port).c_str(), &hints, &addrInfo)) != 0)
+    {
+        // Error!
+        return;
+    }
+
+    // Try to connect
+    m_socket = -1;
+    for (struct addrinfo * address = addrInfo; address != nullptr; address = address->ai_next)
+    {
+        // Create socket
+        if ((m_socket = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol)) == -1)
+        {
+            // Error!
+            continue;
+        }
+
+        // Connect
+        if (::connect(m_socket, address->ai_addr, address->ai_addrlen) == -1)
+        {
+            // Error!
+            #ifdef WIN32
+                _close(m_socket);
+            #else
+                close(m_socket);
+            #endif
+            m_socket = -1;
+            continue;
+        }
+
+        // Connected
+        break;
+    }
+
+    // Clean up
+    freeaddrinfo(addrInfo);
+
+    // Check if connection has been successfull
+    if (m_socket == -1)
+    {
+        return;
+    }
+
+    // Create libssh2 handle
+    m_session = libssh2_session_init();
+    if (m_session)
+    {
+        // Apply transport settings (must be done before the handshake)
+        LIBSSH2_SESSION * session = (LIBSSH2_SESSION *)m_session;
+
+        setMethodPreference(session, LIBSSH2_METHOD_KEX,      m_settings.kex);
+        setMethodPreference(session, LIBSSH2_METHOD_HOSTKEY,  m_settings.hostKeys);
+        setMethodPreference(session, LIBSSH2_METHOD_CRYPT_CS, m_settings.ciphers);
+        setMethodPreference(session, LIBSSH2_METHOD_CRYPT_SC, m_settings.ciphers);
+        setMethodPreference(session, LIBSSH2_METHOD_MAC_CS,   m_settings.macs);
+        setMethodPreference(session, LIBSSH2_METHOD_MAC_SC,   m_settings.macs);
+
+        if (m_settings.compression)
+        {
+            libssh2_session_flag(session, LIBSSH2_FLAG_COMPRESS, 1);
+        }
+
+        // Open session
+        int res = libssh2_session_handshake((LIBSSH2_SESSION *)m_session, m_socket);
+        /*
+        if (res == LIBSSH2_ERROR_SOCKET_NONE)       std::cout << "LIBSSH2_ERROR_SOCKET_NONE" << std::endl;
+        if (res == LIBSSH2_ERROR_BANNER_SEND)       std::cout << "LIBSSH2_ERROR_BANNER_SEND" << std::endl;
+        if (res == LIBSSH2_ERROR_KEX_FAILURE)       std::cout << "LIBSSH2_ERROR_KEX_FAILURE" << std::endl;
+        if (res == LIBSSH2_ERROR_SOCKET_SEND)       std::cout << "LIBSSH2_ERROR_SOCKET_SEND" << std::endl;
+        if (res == LIBSSH2_ERROR_SOCKET_DISCONNECT) std::cout << "LIBSSH2_ERROR_SOCKET_DISCONNECT" << std::endl;
+        if (res == LIBSSH2_ERROR_PROTO)             std::cout << "LIBSSH2_ERROR_PROTO" << std::endl;
+        if (res == LIBSSH2_ERROR_EAGAIN)            std::cout << "LIBSSH2_ERROR_EAGAIN" << std::endl;
+        */
+
+        if (res == 0)
+        {
+            // Get fingerprint
+            std::string fingerprint(libssh2_hostkey_hash((LIBSSH2_SESSION *)m_session, LIBSSH2_HOSTKEY_HASH_SHA1));
+
+            // Try public key authentication first
+            int connect = libssh2_userauth_publickey_fromfile(
+                (LIBSSH2_SESSION *)m_session, m_username.c_str(),
+                m_publicKey.c_str(),
+                m_privateKey.c_str(),
+                m_password.c_str()
+            );
+
+            // Try username/password second
+            if (connect != 0)
+            {
+                connect = libssh2_userauth_password((LIBSSH2_SESSION *)m_session, m_username.c_str(), m_password.c_str());
+            }
+
+            // Have we connected successfully?
+            if (connect == 0)
+            {
+                // Set SSH mode to blocking
+                libssh2_session_set_blocking((LIBSSH2_SESSION *)m_session, 1);
+            }
+            else
+            {
+                // ERROR, could not connect
+                disconnect();
+            }
+        }
+    }
+}
+
+void SshSession::disconnect()
+{
+    // Check if session is already closed
+    if (!m_session) return;
+
+    // Close SFTP session
+    if (m_sftpSession)
+    {
+        libssh2_sftp_shutdown((LIBSSH2_SFTP *)m_sftpSession);
+    }
+
+    // Close SSH session
+    libssh2_session_disconnect((LIBSSH2_SESSION *)m_session, "done");
+    libssh2_session_free      ((LIBSSH2_SESSION *)m_session);
+
+    // Close socket
+    if (m_socket != 0)
+    {
+        #ifdef WIN32
+            closesocket(m_socket);
+        #else
+            ::close(m_socket);
+        #endif
+    }
+
+    // Reset state
+    m_socket      = 0;
+    m_session     = nullptr;
+    m_sftpSession = nullptr;
+}
+
+void SshSession::checkError()
+{
+    // Get SSH error message
+    char * errorMsg;
+    int    len = 1024;
+    libssh2_session_last_error((LIBSSH2_SESSION *)m_session, &errorMsg, &len, 0);
+
+    // [TODO] Log error
+//  std::cout << "SSH ERROR: " << errorMsg << "\n";
+
+    // To recover from errors, it seems to be necessary to reconnect :(
+    connect();
+}
+
+
+} // namespace cppfs
@@ -2,6 +2,7 @@
 #include <cppfs/windows/LocalFileHandle.h>
 
 #include <fstream>
+#include <cerrno>
 
 #include <windows.h>
 
@@ -239,7 +240,7 @@ bool LocalFileHandle::removeDirectory()
     return true;
 }
 
-bool LocalFileHandle::copy(AbstractFileHandleBackend & dest)
+bool LocalFileHandle::copy(AbstractFileHandleBackend & dest, const CopyOptions &)
 {
     // Check source file
     if (!isFile()) return false;
@@ -284,6 +285,12 @@ bool LocalFileHandle::move(AbstractFileHandleBackend & dest)
     // Move file
     if (!MoveFileA(src.c_str(), dst.c_str()))
     {
+        // Directories cannot be moved to other volumes, let FileHandle copy them
+        if (GetLastError() == ERROR_NOT_SAME_DEVICE)
+        {
+            errno = EXDEV;
+        }
+
         // Error!
         return false;
     }
@@ -356,8 +363,8 @@ bool LocalFileHandle::rename(const std::string & filename)
     // Compose new file path
     std::string path = FilePath(FilePath(m_path).directoryPath()).resolve(filename).fullPath();
 
-    // Rename
-    if (!MoveFileA(m_path.c_str(), path.c_str()))
+    // Rename (replacing an existing file, like rename on POSIX systems)
+    if (!MoveFileExA(m_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
     {
         // Error!
         return false;
@@ -2,6 +2,7 @@
 #include <cppfs/windows/LocalFileSystem.h>
 
 #include <cppfs/FileHandle.h>
+#include <cppfs/PollingFileWatcher.h>
 #include <cppfs/windows/LocalFileHandle.h>
 #include <cppfs/windows/LocalFileWatcher.h>
 
@@ -32,8 +33,15 @@ FileHandle LocalFileSystem::open(std::string && path)
     );
 }
 
-std::unique_ptr<AbstractFileWatcherBackend> LocalFileSystem::createFileWatcher(FileWatcher & fileWatcher)
+std::unique_ptr<AbstractFileWatcherBackend> LocalFileSystem::createFileWatcher(FileWatcher & fileWatcher, WatcherType type)
 {
+    if (type == PollingWatcher)
+    {
+        return std::unique_ptr<AbstractFileWatcherBackend>(
+                new PollingFileWatcher(&fileWatcher, shared_from_this())
+        );
+    }
+
     return std::unique_ptr<AbstractFileWatcherBackend>(
             new LocalFileWatcher(&fileWatcher, shared_from_this())
     );
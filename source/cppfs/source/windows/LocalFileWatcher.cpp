@@ -101,6 +101,11 @@ void LocalFileWatcher::add(FileHandle & dir, unsigned int events, RecursiveMode
     m_watchers.push_back(std::move(*watcher.release()));
 }
 
+unsigned int LocalFileWatcher::supportedEvents() const
+{
+    return FileCreated | FileRemoved | FileModified | FileAttrChanged | FileMoved;
+}
+
 void LocalFileWatcher::watch(int timeout)
 {
     ScopedCriticalSection lock(&m_mutexWatchers);
@@ -120,6 +125,7 @@ void LocalFileWatcher::watch(int timeout)
         if (watcher.events & FileRemoved)     flags |= FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME;
         if (watcher.events & FileModified)    flags |= FILE_NOTIFY_CHANGE_LAST_WRITE;
         if (watcher.events & FileAttrChanged) flags |= FILE_NOTIFY_CHANGE_ATTRIBUTES;
+        if (watcher.events & FileMoved)       flags |= FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME;
 
         // Check if data is available
         DWORD size = 0;
@@ -183,6 +189,9 @@ void LocalFileWatcher::watch(int timeout)
     // Read events
     DWORD size = 0;
     if (::GetOverlappedResult(watcher.dirHandle.get(), &watcher.overlapped, &size, FALSE) && size > 0) {
+        // Previous name of a renamed file (followed by an event with the new name)
+        std::string oldName;
+
         // Process events
         char * entry = reinterpret_cast<char *>(watcher.buffer);
         while (entry) {
@@ -217,10 +226,28 @@ void LocalFileWatcher::watch(int timeout)
                         break;
 
                     case FILE_ACTION_MODIFIED:
+                        eventType = FileModified;
+                        break;
+
+                    case FILE_ACTION_RENAMED_OLD_NAME:
+                        oldName = fname;
+                        break;
+
                     case FILE_ACTION_RENAMED_NEW_NAME:
                         eventType = FileModified;
+
+                        // Report rename with both names
+                        if ((watcher.events & FileMoved) && !oldName.empty()) {
+                            FileHandle from = watcher.dir.open(oldName);
+                            FileHandle to   = watcher.dir.open(fname);
+                            onFileMoved(from, to);
+
+                            eventType = (FileEvent)0;
+                        }
+
+                        oldName.clear();
                         break;
-                
+
                     default:
                         break;
                 }
@@ -1,5 +1,8 @@
 
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <string>
 
 #include <cppassist/cmdline/CommandLineProgram.h>
 #include <cppassist/cmdline/CommandLineAction.h>
@@ -35,6 +38,12 @@ int main(int argc, char * argv[])
     CommandLineOption opConfig("--config", "-c", "file", "Load configuration from file", CommandLineOption::Optional);
     action.add(&opConfig);
 
+    CommandLineSwitch swBenchmark("--benchmark", "-b", "Copy the file several times and print the throughput", CommandLineSwitch::Optional);
+    action.add(&swBenchmark);
+
+    CommandLineOption opRuns("--runs", "-r", "count", "Number of runs in benchmark mode (default: 3)", CommandLineOption::Optional);
+    action.add(&opRuns);
+
     CommandLineParameter paramSrc("src", CommandLineParameter::NonOptional);
     action.add(&paramSrc);
 
@@ -64,10 +73,46 @@ int main(int argc, char * argv[])
     std::string dst = paramDst.value();
 
     // Open file handles
+    auto start = std::chrono::steady_clock::now();
+
     FileHandle srcFile = fs::open(src, &login);
     FileHandle dstFile = fs::open(dst, &login);
 
-    if (srcFile.isFile())
+    if (srcFile.isFile() && swBenchmark.activated())
+    {
+        // Connections are opened by fs::open and reused by all runs
+        auto connected = std::chrono::steady_clock::now();
+        std::cout << "connect: " << std::chrono::duration_cast<std::chrono::milliseconds>(connected - start).count() << " ms" << std::endl;
+
+        int runs = opRuns.value().empty() ? 3 : std::max(std::stoi(opRuns.value()), 1);
+        double total = 0.0;
+
+        for (int i = 0; i < runs; i++)
+        {
+            // Copy file
+            auto runStart = std::chrono::steady_clock::now();
+
+            if (!srcFile.copy(dstFile))
+            {
+                std::cout << "Copying '" << src << "' failed." << std::endl;
+                return 1;
+            }
+
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+            total += seconds;
+
+            // Print throughput
+            double mbytes = srcFile.size() / (1024.0 * 1024.0);
+            std::cout << "run " << (i + 1) << ": " << (seconds * 1000.0) << " ms, " << (mbytes / seconds) << " MiB/s" << std::endl;
+        }
+
+        std::cout << "average: " << (total * 1000.0 / runs) << " ms, " << (srcFile.size() / (1024.0 * 1024.0) * runs / total) << " MiB/s" << std::endl;
+
+        // Done
+        return 0;
+    }
+
+    else if (srcFile.isFile())
     {
         // Copy file
         srcFile.copy(dstFile);
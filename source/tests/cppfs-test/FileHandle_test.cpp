@@ -0,0 +1,569 @@
+
+#include <gmock/gmock.h>
+
+#ifndef SYSTEM_WINDOWS
+
+#include <signal.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include <cppfs/fs.h>
+#include <cppfs/FileHandle.h>
+#include <cppfs/FileWriteBatch.h>
+#include <cppfs/Tree.h>
+#include <cppfs/posix/LocalFileSystem.h>
+
+
+using namespace cppfs;
+
+
+class FileHandle_test: public testing::Test
+{
+public:
+    void SetUp() override
+    {
+        char path[] = "/tmp/cppfs-test-XXXXXX";
+        ASSERT_NE(nullptr, mkdtemp(path));
+
+        m_path = path;
+
+        // Files opened on another file system instance are copied by stream copy
+        m_otherFS = std::make_shared<LocalFileSystem>();
+    }
+
+    void TearDown() override
+    {
+        fs::open(m_path).removeDirectoryRec();
+    }
+
+    // Create source file and a partial copy of it together with a progress record
+    void createPartialCopy(const std::string & copied, size_t offset)
+    {
+        m_content = std::string(3 * 1024 * 1024, 'a') + std::string(1024 * 1024, 'b');
+
+        FileHandle src = fs::open(m_path + "/src.bin");
+        ASSERT_TRUE(src.writeFile(m_content));
+
+        ASSERT_TRUE(fs::open(m_path + "/dst.bin").writeFile(copied));
+
+        std::string record = std::to_string(src.size()) + " " + std::to_string(src.modificationTime()) + " " + std::to_string(offset);
+        ASSERT_TRUE(fs::open(m_path + "/dst.bin.cppfs-progress").writeFile(record));
+    }
+
+
+    // Create directory tree with files, subdirectories and a link that points outside of it
+    void createTree(FileHandle & dir)
+    {
+        ASSERT_TRUE(dir.createDirectory());
+        ASSERT_TRUE(fs::open(m_path + "/outside.txt").writeFile("cppfs"));
+
+        for (int i = 0; i < 10; i++) {
+            FileHandle sub = dir.open("sub" + std::to_string(i));
+            ASSERT_TRUE(sub.createDirectory());
+            ASSERT_TRUE(sub.open("nested").createDirectory());
+
+            for (int j = 0; j < 10; j++) {
+                ASSERT_TRUE(sub.open("nested/file" + std::to_string(j) + ".txt").writeFile("cppfs"));
+            }
+        }
+
+        ASSERT_EQ(0, symlink(m_path.c_str(), (m_path + "/tree/link").c_str()));
+    }
+
+
+protected:
+    std::string                         m_path;
+    std::string                         m_content;
+    std::shared_ptr<AbstractFileSystem> m_otherFS;
+};
+
+
+TEST_F(FileHandle_test, copiesBetweenFileSystems)
+{
+    FileHandle src = fs::open(m_path + "/src.txt");
+    ASSERT_TRUE(src.writeFile("cppfs"));
+
+    FileHandle dst = m_otherFS->open(m_path + "/dst.txt");
+    ASSERT_TRUE(src.copy(dst));
+
+    EXPECT_EQ("cppfs", dst.readFile());
+    EXPECT_FALSE(fs::open(m_path + "/dst.txt.cppfs-progress").exists());
+}
+
+TEST_F(FileHandle_test, copiesRangesInParallel)
+{
+    std::string content;
+    for (int i = 0; i < 100000; i++) {
+        content += std::to_string(i) + "\n";
+    }
+
+    FileHandle src = fs::open(m_path + "/src.txt");
+    ASSERT_TRUE(src.writeFile(content));
+
+    CopyOptions options;
+    options.setWorkers(4).setChunkSize(64 * 1024);
+
+    // Within the local file system
+    FileHandle dst = fs::open(m_path + "/dst.txt");
+    ASSERT_TRUE(src.copy(dst, options));
+    EXPECT_EQ(content, dst.readFile());
+
+    // Between file systems
+    FileHandle other = m_otherFS->open(m_path + "/other.txt");
+    ASSERT_TRUE(src.copy(other, options));
+    EXPECT_EQ(content, other.readFile());
+}
+
+TEST_F(FileHandle_test, keepsHolesInSparseFiles)
+{
+    // Create file with 64 MiB of holes and a bit of data at the end
+    std::string path = m_path + "/sparse.img";
+    ASSERT_TRUE(fs::open(path).writeFile("cppfs"));
+    ASSERT_EQ(0, truncate(path.c_str(), 64 * 1024 * 1024));
+    {
+        auto out = fs::open(path).createOutputStream(std::ios::binary | std::ios::in);
+        out->seekp(32 * 1024 * 1024);
+        *out << "data";
+    }
+
+    FileHandle src = fs::open(path);
+    std::string content = src.readFile();
+
+    FileHandle local = fs::open(m_path + "/local.img");
+    FileHandle other = m_otherFS->open(m_path + "/other.img");
+    ASSERT_TRUE(src.copy(local));
+    ASSERT_TRUE(src.copy(other));
+
+    for (auto & file : { m_path + "/local.img", m_path + "/other.img" }) {
+        struct stat info;
+        ASSERT_EQ(0, stat(file.c_str(), &info));
+        EXPECT_EQ(64 * 1024 * 1024, info.st_size);
+        EXPECT_LT(info.st_blocks * 512, 4 * 1024 * 1024);
+        EXPECT_EQ(content, fs::open(file).readFile());
+    }
+}
+
+TEST_F(FileHandle_test, copiesTreesWithLinksAndMetadata)
+{
+    FileHandle src = fs::open(m_path + "/src");
+    ASSERT_TRUE(src.createDirectory());
+    ASSERT_TRUE(src.open("sub").createDirectory());
+
+    for (int i = 0; i < 20; i++) {
+        ASSERT_TRUE(src.open("sub/file" + std::to_string(i) + ".txt").writeFile("cppfs " + std::to_string(i)));
+    }
+
+    std::string file = m_path + "/src/sub/file0.txt";
+    ASSERT_EQ(0, chmod(file.c_str(), 0640));
+    ASSERT_EQ(0, link(file.c_str(), (m_path + "/src/hardlink.txt").c_str()));
+    ASSERT_EQ(0, symlink("sub/file1.txt", (m_path + "/src/symlink.txt").c_str()));
+
+    struct timespec times[2] = { { 1000000000, 0 }, { 1000000000, 0 } };
+    ASSERT_EQ(0, utimensat(AT_FDCWD, file.c_str(), times, 0));
+
+    CopyOptions options;
+    options.setWorkers(4).setPreserveMetadata(true).setPreserveLinks(true);
+
+    FileHandle dst = fs::open(m_path + "/dst");
+    src.copyDirectoryRec(dst, options);
+
+    for (int i = 0; i < 20; i++) {
+        EXPECT_EQ("cppfs " + std::to_string(i), dst.open("sub/file" + std::to_string(i) + ".txt").readFile());
+    }
+
+    struct stat copied, linked, symlinked;
+    ASSERT_EQ(0, stat((m_path + "/dst/sub/file0.txt").c_str(), &copied));
+    ASSERT_EQ(0, stat((m_path + "/dst/hardlink.txt").c_str(), &linked));
+    ASSERT_EQ(0, lstat((m_path + "/dst/symlink.txt").c_str(), &symlinked));
+
+    EXPECT_EQ(0640u, copied.st_mode & 0777);
+    EXPECT_EQ(1000000000, copied.st_mtime);
+    EXPECT_EQ(copied.st_ino, linked.st_ino);
+    EXPECT_TRUE(S_ISLNK(symlinked.st_mode));
+    EXPECT_EQ("cppfs 1", dst.open("symlink.txt").readFile());
+}
+
+TEST_F(FileHandle_test, reportsFailedTreeCopies)
+{
+    FileHandle src = fs::open(m_path + "/src");
+    ASSERT_TRUE(src.createDirectory());
+    ASSERT_TRUE(src.open("sub").createDirectory());
+    ASSERT_TRUE(src.open("sub/file.txt").writeFile("cppfs"));
+
+    // A file in the destination prevents the subdirectory from being created
+    FileHandle dst = fs::open(m_path + "/dst");
+    ASSERT_TRUE(dst.createDirectory());
+    ASSERT_TRUE(dst.open("sub").writeFile("blocked"));
+
+    EXPECT_FALSE(src.copyDirectoryRec(dst, CopyOptions().setWorkers(4)));
+    EXPECT_FALSE(src.copyDirectoryRec(dst, CopyOptions().setPreserveLinks(true).setPreserveMetadata(true)));
+}
+
+TEST_F(FileHandle_test, keepsLinkTargetsIfTreeCopyFails)
+{
+    FileHandle src = fs::open(m_path + "/src");
+    ASSERT_TRUE(src.createDirectory());
+    ASSERT_TRUE(src.open("a.txt").writeFile("cppfs"));
+    ASSERT_TRUE(src.open("sub").createDirectory());
+    ASSERT_TRUE(src.open("sub/x").writeFile("x"));
+    ASSERT_EQ(0, symlink((m_path + "/src/a.txt").c_str(), (m_path + "/src/link").c_str()));
+
+    FileHandle dst = fs::open(m_path + "/dst");
+    ASSERT_TRUE(dst.createDirectory());
+    ASSERT_TRUE(dst.open("sub").writeFile("blocked"));
+
+    // The link that has been re-created in the destination must not be written through
+    EXPECT_FALSE(src.copyDirectoryRec(dst, CopyOptions().setPreserveLinks(true)));
+    EXPECT_EQ("cppfs", fs::open(m_path + "/src/a.txt").readFile());
+    EXPECT_TRUE(fs::open(m_path + "/dst/link").isSymbolicLink());
+}
+
+TEST_F(FileHandle_test, clonesDirectories)
+{
+    FileHandle src = fs::open(m_path + "/src");
+    ASSERT_TRUE(src.createDirectory());
+    ASSERT_TRUE(src.open("sub").createDirectory());
+    ASSERT_TRUE(src.open("a.txt").writeFile("cppfs"));
+    ASSERT_TRUE(src.open("sub/b.txt").writeFile("cloned"));
+
+    // Files are cloned or, if the file system does not support it, copied
+    unsigned long long cloned = 0;
+    unsigned long long copied = 0;
+
+    FileHandle dst = fs::open(m_path + "/dst");
+    ASSERT_TRUE(src.cloneDirectory(dst, CopyOptions(), &cloned, &copied));
+
+    EXPECT_EQ("cppfs",  dst.open("a.txt").readFile());
+    EXPECT_EQ("cloned", dst.open("sub/b.txt").readFile());
+    EXPECT_EQ(11u, cloned + copied);
+
+    // Cloning between file systems is not supported
+    FileHandle other = m_otherFS->open(m_path + "/other");
+    EXPECT_FALSE(src.cloneDirectory(other));
+    EXPECT_FALSE(other.exists());
+}
+
+TEST_F(FileHandle_test, hashesOnlyRegularFilesOfTrees)
+{
+    FileHandle dir = fs::open(m_path);
+    ASSERT_TRUE(dir.open("file.txt").writeFile("cppfs"));
+    ASSERT_EQ(0, mkfifo((m_path + "/fifo").c_str(), 0600));
+
+    // Reading the FIFO would block
+    auto tree = dir.readTree("", true);
+    ASSERT_TRUE(tree != nullptr);
+
+    for (auto & child : tree->children()) {
+        if (child->fileName() == "file.txt") {
+            EXPECT_EQ(fs::sha1("cppfs"), child->sha1());
+        } else {
+            EXPECT_TRUE(child->sha1().empty());
+        }
+    }
+}
+
+TEST_F(FileHandle_test, removesTrees)
+{
+    FileHandle dir = fs::open(m_path + "/tree");
+    createTree(dir);
+
+    dir.removeDirectoryRec();
+
+    EXPECT_FALSE(dir.exists());
+    EXPECT_TRUE(fs::open(m_path + "/outside.txt").exists());
+}
+
+TEST_F(FileHandle_test, removesTreesInBackground)
+{
+    FileHandle dir = fs::open(m_path + "/tree");
+    createTree(dir);
+
+    ASSERT_TRUE(dir.removeDirectoryRecAsync());
+    EXPECT_FALSE(dir.exists());
+
+    // Wait for the trash to be removed
+    EXPECT_TRUE(fs::waitForRemovals(10000));
+    EXPECT_EQ(0u, fs::pendingRemovals());
+    EXPECT_EQ(std::vector<std::string>{ "outside.txt" }, fs::open(m_path).listFiles());
+}
+
+TEST_F(FileHandle_test, collectsTrashOfExitedProcesses)
+{
+    // Get id of a process that has exited
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) _exit(0);
+    ASSERT_EQ(pid, waitpid(pid, nullptr, 0));
+
+    FileHandle dir = fs::open(m_path + "/tree");
+    createTree(dir);
+
+    FileHandle stale = fs::open(m_path + "/.cppfs-trash-" + std::to_string(pid) + "-0");
+    ASSERT_TRUE(stale.createDirectory());
+    ASSERT_TRUE(stale.open("sub").createDirectory());
+    ASSERT_TRUE(stale.open("sub/file.txt").writeFile("cppfs"));
+
+    ASSERT_TRUE(dir.removeDirectoryRecAsync());
+    EXPECT_TRUE(fs::waitForRemovals(10000));
+    EXPECT_EQ(std::vector<std::string>{ "outside.txt" }, fs::open(m_path).listFiles());
+}
+
+TEST_F(FileHandle_test, movesBetweenFileSystems)
+{
+    FileHandle file = fs::open(m_path + "/file.txt");
+    ASSERT_TRUE(file.writeFile("cppfs"));
+
+    FileHandle dir = fs::open(m_path + "/tree");
+    ASSERT_TRUE(dir.createDirectory());
+    ASSERT_TRUE(dir.open("sub").createDirectory());
+    ASSERT_TRUE(dir.open("sub/file.txt").writeFile("moved"));
+
+    FileHandle target = m_otherFS->open(m_path + "/target");
+    ASSERT_TRUE(target.createDirectory());
+
+    // Move file and directory into the target directory
+    FileHandle dst = m_otherFS->open(m_path + "/target");
+    ASSERT_TRUE(file.move(dst));
+    ASSERT_TRUE(dir.move(dst));
+
+    EXPECT_FALSE(fs::open(m_path + "/file.txt").exists());
+    EXPECT_FALSE(fs::open(m_path + "/tree").exists());
+    EXPECT_EQ("cppfs", fs::open(m_path + "/target/file.txt").readFile());
+    EXPECT_EQ("moved", fs::open(m_path + "/target/tree/sub/file.txt").readFile());
+
+    // No staging copies are left behind
+    std::vector<std::string> files = target.listFiles();
+    std::sort(files.begin(), files.end());
+    EXPECT_EQ((std::vector<std::string>{ "file.txt", "tree" }), files);
+
+    // Directories are not moved onto existing ones
+    FileHandle again = fs::open(m_path + "/tree");
+    ASSERT_TRUE(again.createDirectory());
+
+    EXPECT_FALSE(again.move(dst));
+    EXPECT_TRUE(again.exists());
+    EXPECT_EQ("moved", fs::open(m_path + "/target/tree/sub/file.txt").readFile());
+}
+
+TEST_F(FileHandle_test, movesTreesWithRelativeLinksBetweenDevices)
+{
+    FileHandle dir = fs::open(m_path + "/tree");
+    ASSERT_TRUE(dir.createDirectory());
+    ASSERT_TRUE(dir.open("file.txt").writeFile("cppfs"));
+    ASSERT_TRUE(fs::open(m_path + "/shared").createDirectory());
+    ASSERT_TRUE(fs::open(m_path + "/shared/lib.txt").writeFile("shared"));
+    ASSERT_EQ(0, symlink("../shared/lib.txt", (m_path + "/tree/lib").c_str()));
+
+    // Another device on the same file system is needed
+    char shmPath[] = "/dev/shm/cppfs-test-XXXXXX";
+    if (!mkdtemp(shmPath)) return;
+
+    FileHandle shm = fs::open(shmPath);
+
+    if (shm.deviceId() != dir.deviceId()) {
+        // The link dangles at the new location, but is moved like with rename
+        EXPECT_TRUE(dir.move(shm));
+        EXPECT_FALSE(fs::open(m_path + "/tree").exists());
+        EXPECT_EQ("cppfs", shm.open("tree/file.txt").readFile());
+        EXPECT_TRUE(shm.open("tree/lib").isSymbolicLink());
+    }
+
+    shm.removeDirectoryRec();
+}
+
+TEST_F(FileHandle_test, replacesFilesAtomically)
+{
+    std::string path = m_path + "/config.txt";
+    ASSERT_TRUE(fs::open(path).writeFile("old"));
+    ASSERT_EQ(0, chmod(path.c_str(), 0640));
+
+    FileHandle file = fs::open(path);
+    ASSERT_TRUE(file.writeFileAtomic("new", true));
+    EXPECT_EQ("new", file.readFile());
+
+    // New files are created as well
+    ASSERT_TRUE(fs::open(m_path + "/created.txt").writeFileAtomic("created"));
+    EXPECT_EQ("created", fs::open(m_path + "/created.txt").readFile());
+
+    struct stat info;
+    ASSERT_EQ(0, stat(path.c_str(), &info));
+    EXPECT_EQ(0640u, info.st_mode & 0777);
+
+    // No temporary files are left behind
+    std::vector<std::string> files = fs::open(m_path).listFiles();
+    std::sort(files.begin(), files.end());
+    EXPECT_EQ((std::vector<std::string>{ "config.txt", "created.txt" }), files);
+}
+
+TEST_F(FileHandle_test, replacesTargetsOfLinksAtomically)
+{
+    ASSERT_TRUE(fs::open(m_path + "/target.txt").writeFile("old"));
+    ASSERT_EQ(0, symlink("target.txt", (m_path + "/link.txt").c_str()));
+
+    FileHandle link = fs::open(m_path + "/link.txt");
+    ASSERT_TRUE(link.writeFileAtomic("new", true));
+
+    // The link is kept and points to the new content
+    EXPECT_TRUE(fs::open(m_path + "/link.txt").isSymbolicLink());
+    EXPECT_EQ("new", fs::open(m_path + "/target.txt").readFile());
+
+    // Batches cannot replace the target of a link
+    FileWriteBatch batch;
+    EXPECT_FALSE(batch.add(link, "batch"));
+}
+
+TEST_F(FileHandle_test, replacesFilesInBatches)
+{
+    ASSERT_TRUE(fs::open(m_path + "/file0.txt").writeFile("old"));
+
+    {
+        FileWriteBatch batch;
+
+        for (int i = 0; i < 100; i++) {
+            ASSERT_TRUE(batch.add(fs::open(m_path + "/file" + std::to_string(i) + ".txt"), "new " + std::to_string(i)));
+        }
+
+        // Files are replaced on commit
+        EXPECT_EQ("old", fs::open(m_path + "/file0.txt").readFile());
+        EXPECT_FALSE(fs::open(m_path + "/file1.txt").exists());
+
+        ASSERT_TRUE(batch.commit());
+    }
+
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQ("new " + std::to_string(i), fs::open(m_path + "/file" + std::to_string(i) + ".txt").readFile());
+    }
+
+    // Files on the same device share one flush, batches own their hidden files
+    EXPECT_NE(0u, fs::open(m_path).deviceId());
+    EXPECT_EQ(fs::open(m_path).deviceId(), fs::open(m_path + "/file0.txt").deviceId());
+    EXPECT_FALSE(std::is_copy_constructible<FileWriteBatch>::value);
+    EXPECT_FALSE(std::is_copy_assignable<FileWriteBatch>::value);
+
+    // Batches that are not committed are discarded
+    {
+        FileWriteBatch batch;
+        ASSERT_TRUE(batch.add(fs::open(m_path + "/file0.txt"), "discarded"));
+    }
+
+    EXPECT_EQ("new 0", fs::open(m_path + "/file0.txt").readFile());
+    EXPECT_EQ(100u, fs::open(m_path).listFiles().size());
+}
+
+TEST_F(FileHandle_test, keepsSourceIfMoveFails)
+{
+    std::string content(3 * 1024 * 1024, 'x');
+
+    FileHandle file = fs::open(m_path + "/file.bin");
+    ASSERT_TRUE(file.writeFile(content));
+
+    FileHandle dir = fs::open(m_path + "/tree");
+    ASSERT_TRUE(dir.createDirectory());
+    ASSERT_TRUE(dir.open("sub").createDirectory());
+    ASSERT_TRUE(dir.open("sub/file.bin").writeFile(content));
+
+    // Targets of links are not written through, even if they are outside of the tree
+    ASSERT_TRUE(fs::open(m_path + "/keep.txt").writeFile("keep"));
+    ASSERT_EQ(0, symlink((m_path + "/keep.txt").c_str(), (m_path + "/tree/link").c_str()));
+
+    FileHandle target = m_otherFS->open(m_path + "/target");
+    ASSERT_TRUE(target.createDirectory());
+
+    // Move to another device on the same file system as well, if there is one
+    char shmPath[] = "/dev/shm/cppfs-test-XXXXXX";
+    FileHandle shm;
+
+    if (mkdtemp(shmPath)) {
+        shm = fs::open(shmPath);
+
+        if (shm.deviceId() == dir.deviceId()) {
+            shm.removeDirectory();
+            shm = FileHandle();
+        }
+    }
+
+    // Let writes fail after 1 MiB, like on a full disk
+    struct rlimit limit, old;
+    ASSERT_EQ(0, getrlimit(RLIMIT_FSIZE, &old));
+    limit = old;
+    limit.rlim_cur = 1024 * 1024;
+
+    auto handler = signal(SIGXFSZ, SIG_IGN);
+    ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &limit));
+
+    bool fileMoved = file.move(target);
+    bool dirMoved  = dir.move(target);
+    bool shmMoved  = shm.isDirectory() && dir.move(shm);
+
+    setrlimit(RLIMIT_FSIZE, &old);
+    signal(SIGXFSZ, handler);
+
+    EXPECT_FALSE(fileMoved);
+    EXPECT_FALSE(dirMoved);
+    EXPECT_FALSE(shmMoved);
+    EXPECT_EQ(content, fs::open(m_path + "/file.bin").readFile());
+    EXPECT_EQ(content, fs::open(m_path + "/tree/sub/file.bin").readFile());
+    EXPECT_EQ("keep", fs::open(m_path + "/keep.txt").readFile());
+    EXPECT_TRUE(fs::open(m_path + "/tree/link").isSymbolicLink());
+    EXPECT_TRUE(target.listFiles().empty());
+
+    if (shm.isDirectory()) {
+        EXPECT_TRUE(shm.listFiles().empty());
+        shm.removeDirectoryRec();
+    }
+}
+
+TEST_F(FileHandle_test, continuesInterruptedCopy)
+{
+    // The marker after the recorded offset must be overwritten, the data before it is kept
+    size_t offset = 2 * 1024 * 1024;
+    createPartialCopy(std::string(offset, 'a') + "marker", offset);
+
+    FileHandle src = fs::open(m_path + "/src.bin");
+    FileHandle dst = m_otherFS->open(m_path + "/dst.bin");
+    ASSERT_TRUE(src.copy(dst));
+
+    EXPECT_EQ(m_content, dst.readFile());
+    EXPECT_FALSE(fs::open(m_path + "/dst.bin.cppfs-progress").exists());
+}
+
+TEST_F(FileHandle_test, overwritesOldDataWithZerosWhenContinuing)
+{
+    size_t offset = 2 * 1024 * 1024;
+    std::string content = std::string(offset, 'a') + std::string(1024 * 1024, '\0') + std::string(1024 * 1024, 'b');
+
+    FileHandle src = fs::open(m_path + "/src.bin");
+    ASSERT_TRUE(src.writeFile(content));
+    ASSERT_TRUE(fs::open(m_path + "/dst.bin").writeFile(std::string(offset, 'a') + std::string(1024 * 1024, 'x')));
+
+    std::string record = std::to_string(src.size()) + " " + std::to_string(src.modificationTime()) + " " + std::to_string(offset);
+    ASSERT_TRUE(fs::open(m_path + "/dst.bin.cppfs-progress").writeFile(record));
+
+    // Zero blocks after the offset must not leave the old data in place
+    FileHandle dst = m_otherFS->open(m_path + "/dst.bin");
+    ASSERT_TRUE(src.copy(dst));
+    EXPECT_TRUE(content == dst.readFile());
+}
+
+TEST_F(FileHandle_test, startsOverIfCopiedDataDiffers)
+{
+    size_t offset = 2 * 1024 * 1024;
+    createPartialCopy(std::string(offset, 'x'), offset);
+
+    FileHandle src = fs::open(m_path + "/src.bin");
+    FileHandle dst = m_otherFS->open(m_path + "/dst.bin");
+    ASSERT_TRUE(src.copy(dst));
+
+    EXPECT_EQ(m_content, dst.readFile());
+}
+
+#endif
@@ -0,0 +1,340 @@
+
+#include <gmock/gmock.h>
+
+#ifdef SYSTEM_LINUX
+
+#include <poll.h>
+#include <stdlib.h>
+
+#include <string>
+#include <ostream>
+#include <vector>
+#include <utility>
+
+#include <cppfs/fs.h>
+#include <cppfs/FileHandle.h>
+#include <cppfs/FileWatcher.h>
+#include <cppfs/FileEventHandler.h>
+#include <cppfs/FileEventInfo.h>
+
+
+using namespace cppfs;
+
+
+class MoveHandler : public FileEventHandler
+{
+public:
+    std::vector< std::pair<std::string, std::string> > moves;
+    std::vector<std::string>                          created;
+
+
+protected:
+    void onFileCreated(FileHandle & fh) override
+    {
+        created.push_back(fh.path());
+    }
+
+    void onFileMoved(FileHandle & from, FileHandle & to) override
+    {
+        moves.push_back(std::make_pair(from.fileName(), to.fileName()));
+    }
+};
+
+
+class FileWatcher_test: public testing::TestWithParam<WatcherType>
+{
+public:
+    void SetUp() override
+    {
+        char path[] = "/tmp/cppfs-test-XXXXXX";
+        ASSERT_NE(nullptr, mkdtemp(path));
+
+        m_path = path;
+    }
+
+    void TearDown() override
+    {
+        fs::open(m_path).removeDirectoryRec();
+    }
+
+    // Watch until an event for the given file has been received
+    bool waitForEvent(FileWatcher & watcher, const std::string & fileName, FileEvent event)
+    {
+        for (int i = 0; i < 20; i++)
+        {
+            for (auto & e : m_events)
+            {
+                if (e.first == fileName && e.second == event) return true;
+            }
+
+            watcher.watch(100);
+        }
+
+        return false;
+    }
+
+
+protected:
+    std::string                                    m_path;
+    std::vector< std::pair<std::string, FileEvent> > m_events;
+};
+
+
+TEST_P(FileWatcher_test, reportsEventsRecursively)
+{
+    FileHandle dir    = fs::open(m_path);
+    FileHandle subDir = dir.open("sub");
+    ASSERT_TRUE(subDir.createDirectory());
+
+    FileWatcher watcher(fs::localFS().get(), GetParam());
+    watcher.add(dir);
+    watcher.addHandler([this] (FileHandle & fh, FileEvent event) {
+        m_events.push_back(std::make_pair(fh.fileName(), event));
+    });
+
+    FileHandle file = subDir.open("file.txt");
+    ASSERT_TRUE(file.writeFile("cppfs"));
+    EXPECT_TRUE(waitForEvent(watcher, "file.txt", FileCreated));
+
+    ASSERT_TRUE(file.remove());
+    EXPECT_TRUE(waitForEvent(watcher, "file.txt", FileRemoved));
+}
+
+TEST_P(FileWatcher_test, ignoresSubdirectoriesIfNonRecursive)
+{
+    FileHandle dir    = fs::open(m_path);
+    FileHandle subDir = dir.open("sub");
+    ASSERT_TRUE(subDir.createDirectory());
+
+    FileWatcher watcher(fs::localFS().get(), GetParam());
+    watcher.add(dir, FileCreated, NonRecursive);
+    watcher.addHandler([this] (FileHandle & fh, FileEvent event) {
+        m_events.push_back(std::make_pair(fh.fileName(), event));
+    });
+
+    ASSERT_TRUE(subDir.open("nested.txt").writeFile("cppfs"));
+    ASSERT_TRUE(dir.open("direct.txt").writeFile("cppfs"));
+    EXPECT_TRUE(waitForEvent(watcher, "direct.txt", FileCreated));
+    EXPECT_FALSE(waitForEvent(watcher, "nested.txt", FileCreated));
+}
+
+TEST_P(FileWatcher_test, processesPendingEventsFromNativeHandle)
+{
+    FileHandle dir = fs::open(m_path);
+
+    FileWatcher watcher(fs::localFS().get(), GetParam());
+    watcher.add(dir);
+    watcher.addHandler([this] (FileHandle & fh, FileEvent event) {
+        m_events.push_back(std::make_pair(fh.fileName(), event));
+    });
+
+    // Nothing pending, must not block
+    watcher.processPending();
+    EXPECT_TRUE(m_events.empty());
+
+    ASSERT_TRUE(dir.open("file.txt").writeFile("cppfs"));
+
+    struct pollfd fd;
+    fd.fd      = watcher.nativeHandle();
+    fd.events  = POLLIN;
+    fd.revents = 0;
+    ASSERT_GE(fd.fd, 0);
+    ASSERT_EQ(1, poll(&fd, 1, 2000));
+
+    watcher.processPending();
+
+    bool created = false;
+    for (auto & e : m_events) {
+        if (e.first == "file.txt" && e.second == FileCreated) created = true;
+    }
+    EXPECT_TRUE(created);
+}
+
+TEST_P(FileWatcher_test, reportsRenamesAsMoves)
+{
+    FileHandle dir    = fs::open(m_path);
+    FileHandle subDir = dir.open("sub");
+    ASSERT_TRUE(subDir.createDirectory());
+    ASSERT_TRUE(subDir.open("a.txt").writeFile("cppfs"));
+
+    MoveHandler handler;
+
+    FileWatcher watcher(fs::localFS().get(), GetParam());
+    watcher.add(dir, FileCreated | FileRemoved | FileMoved);
+    watcher.addHandler(&handler);
+    watcher.addHandler([this] (FileHandle & fh, FileEvent event) {
+        m_events.push_back(std::make_pair(fh.fileName(), event));
+    });
+
+    FileHandle file = subDir.open("a.txt");
+    ASSERT_TRUE(file.rename("b.txt"));
+    EXPECT_TRUE(waitForEvent(watcher, "b.txt", FileMoved));
+    ASSERT_EQ(1u, handler.moves.size());
+    EXPECT_EQ("a.txt", handler.moves[0].first);
+    EXPECT_EQ("b.txt", handler.moves[0].second);
+
+    // Events in renamed directories are reported with the new path
+    ASSERT_TRUE(subDir.rename("sub2"));
+    EXPECT_TRUE(waitForEvent(watcher, "sub2", FileMoved));
+
+    ASSERT_TRUE(dir.open("sub2/c.txt").writeFile("cppfs"));
+    EXPECT_TRUE(waitForEvent(watcher, "c.txt", FileCreated));
+    ASSERT_FALSE(handler.created.empty());
+    EXPECT_NE(std::string::npos, handler.created.back().find("/sub2/c.txt"));
+}
+
+TEST_P(FileWatcher_test, reportsRenamesAsRemovedAndCreatedByDefault)
+{
+    FileHandle dir = fs::open(m_path);
+    ASSERT_TRUE(dir.open("a.txt").writeFile("cppfs"));
+
+    FileWatcher watcher(fs::localFS().get(), GetParam());
+    watcher.add(dir);
+    watcher.addHandler([this] (FileHandle & fh, FileEvent event) {
+        m_events.push_back(std::make_pair(fh.fileName(), event));
+    });
+
+    ASSERT_TRUE(dir.open("a.txt").rename("b.txt"));
+    EXPECT_TRUE(waitForEvent(watcher, "a.txt", FileRemoved));
+    EXPECT_TRUE(waitForEvent(watcher, "b.txt", FileCreated));
+    EXPECT_FALSE(waitForEvent(watcher, "b.txt", FileMoved));
+}
+
+TEST_P(FileWatcher_test, reportsMovesOutOfWatchedDirectoriesAsRemoved)
+{
+    FileHandle dir    = fs::open(m_path);
+    FileHandle subDir = dir.open("sub");
+    ASSERT_TRUE(subDir.createDirectory());
+    ASSERT_TRUE(dir.open("a.txt").writeFile("cppfs"));
+
+    FileWatcher watcher(fs::localFS().get(), GetParam());
+    watcher.add(dir, FileCreated | FileRemoved | FileMoved, NonRecursive);
+    watcher.addHandler([this] (FileHandle & fh, FileEvent event) {
+        m_events.push_back(std::make_pair(fh.fileName(), event));
+    });
+
+    FileHandle file = dir.open("a.txt");
+    FileHandle dest = subDir.open("a.txt");
+    ASSERT_TRUE(file.move(dest));
+    EXPECT_TRUE(waitForEvent(watcher, "a.txt", FileRemoved));
+    EXPECT_FALSE(waitForEvent(watcher, "a.txt", FileMoved));
+}
+
+TEST_P(FileWatcher_test, reportsClosedWriteOncePerFile)
+{
+    FileHandle dir = fs::open(m_path);
+
+    FileWatcher watcher(fs::localFS().get(), GetParam());
+    watcher.add(dir, FileClosedWrite);
+    watcher.addHandler([this] (FileHandle & fh, FileEvent event) {
+        m_events.push_back(std::make_pair(fh.fileName(), event));
+    });
+
+    {
+        auto out = dir.open("file.txt").createOutputStream();
+        ASSERT_TRUE(out != nullptr);
+
+        for (int i = 0; i < 100; i++) {
+            *out << "cppfs" << std::flush;
+        }
+    }
+
+    EXPECT_TRUE(waitForEvent(watcher, "file.txt", FileClosedWrite));
+
+    for (auto & e : m_events) {
+        EXPECT_EQ(FileClosedWrite, e.second);
+    }
+
+    EXPECT_EQ(1u, m_events.size());
+}
+
+class BatchHandler : public FileEventHandler
+{
+public:
+    std::vector<FileEventInfo> events;
+    int                        batches = 0;
+
+
+protected:
+    void onFileEvents(const std::vector<FileEventInfo> & batch) override
+    {
+        events.insert(events.end(), batch.begin(), batch.end());
+        batches++;
+    }
+};
+
+TEST_P(FileWatcher_test, deliversEventsInBatches)
+{
+    FileHandle dir = fs::open(m_path);
+
+    BatchHandler handler;
+
+    FileWatcher watcher(fs::localFS().get(), GetParam());
+    watcher.add(dir, FileCreated);
+    watcher.addHandler(&handler);
+
+    for (int i = 0; i < 10; i++) {
+        ASSERT_TRUE(dir.open("file" + std::to_string(i) + ".txt").writeFile("cppfs"));
+    }
+
+    for (int i = 0; i < 20 && handler.events.size() < 10; i++) {
+        watcher.watch(100);
+    }
+
+    ASSERT_EQ(10u, handler.events.size());
+    EXPECT_LT(handler.batches, 10);
+
+    for (auto & event : handler.events) {
+        EXPECT_EQ(FileCreated, event.event());
+        EXPECT_FALSE(event.isDirectory());
+        EXPECT_EQ(event.path(), event.fileHandle().path());
+        EXPECT_TRUE(event.fileHandle().isFile());
+    }
+}
+
+class HookWatcher : public FileWatcher
+{
+public:
+    HookWatcher(AbstractFileSystem * fs, WatcherType type)
+    : FileWatcher(fs, type)
+    {
+    }
+
+    std::vector< std::pair<std::string, FileEvent> > events;
+
+
+protected:
+    void onFileEvent(FileHandle & fh, FileEvent event) override
+    {
+        events.push_back(std::make_pair(fh.fileName(), event));
+    }
+};
+
+TEST_P(FileWatcher_test, forwardsEventsToWatcherHooks)
+{
+    FileHandle dir = fs::open(m_path);
+
+    BatchHandler handler;
+
+    HookWatcher watcher(fs::localFS().get(), GetParam());
+    watcher.add(dir, FileCreated);
+    watcher.addHandler(&handler);
+
+    ASSERT_TRUE(dir.open("file.txt").writeFile("cppfs"));
+
+    for (int i = 0; i < 20 && watcher.events.empty(); i++) {
+        watcher.watch(100);
+    }
+
+    ASSERT_EQ(1u, watcher.events.size());
+    EXPECT_EQ("file.txt", watcher.events[0].first);
+    EXPECT_EQ(FileCreated, watcher.events[0].second);
+
+    // Handlers still receive the batch, including the native event mask
+    ASSERT_EQ(1u, handler.events.size());
+    EXPECT_NE(0u, handler.events[0].mask());
+}
+
+INSTANTIATE_TEST_CASE_P(WatcherTypes, FileWatcher_test, testing::Values(DefaultWatcher, FanotifyWatcher));
+
+#endif
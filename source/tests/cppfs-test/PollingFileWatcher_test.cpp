@@ -0,0 +1,161 @@
+
+#include <gmock/gmock.h>
+
+#ifndef SYSTEM_WINDOWS
+
+#include <stdlib.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <utility>
+
+#include <cppfs/fs.h>
+#include <cppfs/FileHandle.h>
+#include <cppfs/FileWatcher.h>
+#include <cppfs/PollingFileWatcher.h>
+
+
+using namespace cppfs;
+
+
+class PollingFileWatcher_test: public testing::Test
+{
+public:
+    void SetUp() override
+    {
+        char path[] = "/tmp/cppfs-test-XXXXXX";
+        ASSERT_NE(nullptr, mkdtemp(path));
+
+        m_path = path;
+    }
+
+    void TearDown() override
+    {
+        fs::open(m_path).removeDirectoryRec();
+    }
+
+    // Create polling watcher with short intervals
+    PollingFileWatcher * createWatcher(FileWatcher & watcher)
+    {
+        auto * backend = dynamic_cast<PollingFileWatcher *>(watcher.backend());
+        if (backend) {
+            backend->setPollInterval(10, 50);
+        }
+
+        watcher.addHandler([this] (FileHandle & fh, FileEvent event) {
+            m_events.push_back(std::make_pair(fh.fileName(), event));
+        });
+
+        return backend;
+    }
+
+    // Watch until an event for the given file has been received
+    bool waitForEvent(FileWatcher & watcher, const std::string & fileName, FileEvent event)
+    {
+        for (int i = 0; i < 20; i++)
+        {
+            for (auto & e : m_events)
+            {
+                if (e.first == fileName && e.second == event) return true;
+            }
+
+            watcher.watch(100);
+        }
+
+        return false;
+    }
+
+
+protected:
+    std::string                                    m_path;
+    std::vector< std::pair<std::string, FileEvent> > m_events;
+};
+
+
+TEST_F(PollingFileWatcher_test, reportsChangesBetweenSnapshots)
+{
+    FileHandle dir    = fs::open(m_path);
+    FileHandle subDir = dir.open("sub");
+    ASSERT_TRUE(subDir.createDirectory());
+
+    FileWatcher watcher(fs::localFS().get(), PollingWatcher);
+    ASSERT_NE(nullptr, createWatcher(watcher));
+    watcher.add(dir);
+
+    FileHandle file = subDir.open("file.txt");
+    ASSERT_TRUE(file.writeFile("cppfs"));
+    EXPECT_TRUE(waitForEvent(watcher, "file.txt", FileCreated));
+
+    ASSERT_TRUE(file.writeFile("cppfs-modified"));
+    EXPECT_TRUE(waitForEvent(watcher, "file.txt", FileModified));
+
+    ASSERT_TRUE(file.remove());
+    EXPECT_TRUE(waitForEvent(watcher, "file.txt", FileRemoved));
+
+    // Contents of new directories are reported
+    FileHandle newDir = dir.open("new");
+    ASSERT_TRUE(newDir.createDirectory());
+    ASSERT_TRUE(newDir.open("nested.txt").writeFile("cppfs"));
+    EXPECT_TRUE(waitForEvent(watcher, "new", FileCreated));
+    EXPECT_TRUE(waitForEvent(watcher, "nested.txt", FileCreated));
+}
+
+TEST_F(PollingFileWatcher_test, limitsStatsPerPollCycle)
+{
+    FileHandle dir = fs::open(m_path);
+    for (auto name : { "a", "b", "c" }) {
+        ASSERT_TRUE(dir.open(name).createDirectory());
+    }
+
+    FileWatcher watcher(fs::localFS().get(), PollingWatcher);
+    auto * backend = createWatcher(watcher);
+    ASSERT_NE(nullptr, backend);
+    backend->setStatBudget(1);
+    watcher.add(dir);
+
+    // The initial snapshot of the subdirectories is also taken within the budget
+    for (int i = 0; i < 5; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        watcher.processPending();
+    }
+
+    EXPECT_TRUE(m_events.empty());
+
+    for (auto name : { "a", "b", "c" }) {
+        ASSERT_TRUE(dir.open(name).open("file.txt").writeFile("cppfs"));
+    }
+
+    // Each cycle scans at least one directory, but not more than the budget allows
+    for (int i = 0; i < 100 && m_events.size() < 3; i++) {
+        size_t before = m_events.size();
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        watcher.processPending();
+
+        EXPECT_LE(m_events.size() - before, 1u);
+    }
+
+    EXPECT_EQ(3u, m_events.size());
+}
+
+TEST_F(PollingFileWatcher_test, emulatesClosedWriteBySettling)
+{
+    FileHandle dir = fs::open(m_path);
+
+    FileWatcher watcher(fs::localFS().get(), PollingWatcher);
+    ASSERT_NE(nullptr, createWatcher(watcher));
+    watcher.setSettleTime(50);
+    watcher.add(dir, FileClosedWrite);
+
+    ASSERT_TRUE(dir.open("file.txt").writeFile("cppfs"));
+    EXPECT_TRUE(waitForEvent(watcher, "file.txt", FileClosedWrite));
+
+    // Events that are only needed for settle detection are not reported
+    for (auto & e : m_events) {
+        EXPECT_EQ(FileClosedWrite, e.second);
+    }
+}
+
+#endif